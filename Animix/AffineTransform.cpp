@@ -0,0 +1,107 @@
+#include "AffineTransform.h"
+
+#include <cassert>
+#include <cmath>
+
+
+namespace Animix
+{
+	static_assert(sizeof(gef::Matrix44) == 16 * sizeof(float), "Matrix44 must be four tightly packed rows");
+
+
+	AffineTransform AffineTransform::FromMatrix(const gef::Matrix44& matrix)
+	{
+		AffineTransform result;
+		for (int row = 0; row < 4; row++)
+		{
+			const gef::Vector4 r = matrix.GetRow(row);
+			result.Columns[0][row] = r.x();
+			result.Columns[1][row] = r.y();
+			result.Columns[2][row] = r.z();
+		}
+		return result;
+	}
+
+	void AffineTransform::ToMatrix(gef::Matrix44& outMatrix) const
+	{
+#if ANIMIX_SSE
+		// Palettes are converted every update, so write the rows directly; GetRow returns references to them
+		__m128 c0 = _mm_loadu_ps(Columns[0]);
+		__m128 c1 = _mm_loadu_ps(Columns[1]);
+		__m128 c2 = _mm_loadu_ps(Columns[2]);
+		__m128 c3 = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+		float* rows = reinterpret_cast<float*>(&outMatrix);
+		_mm_storeu_ps(rows, c0);
+		_mm_storeu_ps(rows + 4, c1);
+		_mm_storeu_ps(rows + 8, c2);
+		_mm_storeu_ps(rows + 12, c3);
+#else
+		for (int row = 0; row < 4; row++)
+			outMatrix.SetRow(row, gef::Vector4(Columns[0][row], Columns[1][row], Columns[2][row], row == 3 ? 1.0f : 0.0f));
+#endif
+	}
+
+	bool AffineTransform::IsRigid(float tolerance) const
+	{
+		// Element (row, column) of the 3x3 part
+		const auto m = [this](int row, int column) { return Columns[column][row]; };
+
+		// The rows must be orthonormal
+		for (int a = 0; a < 3; a++)
+		{
+			for (int b = a; b < 3; b++)
+			{
+				const float dot = m(a, 0) * m(b, 0) + m(a, 1) * m(b, 1) + m(a, 2) * m(b, 2);
+				if (std::fabs(dot - (a == b ? 1.0f : 0.0f)) > tolerance)
+					return false;
+			}
+		}
+
+		// and not reflect
+		const float det = m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1))
+			- m(0, 1) * (m(1, 0) * m(2, 2) - m(1, 2) * m(2, 0))
+			+ m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0));
+		return det > 0.0f;
+	}
+
+	AffineTransform AffineTransform::Inverse(const AffineTransform& transform)
+	{
+		// Element (row, column) of the 3x3 part
+		const auto m = [&transform](int row, int column) { return transform.Columns[column][row]; };
+
+		// Cofactors of the first row, which also give the determinant
+		const float c00 = m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1);
+		const float c01 = m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2);
+		const float c02 = m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0);
+		const float det = m(0, 0) * c00 + m(0, 1) * c01 + m(0, 2) * c02;
+		assert(std::fabs(det) > 1e-12f && "Transform is not invertible");
+		const float invDet = 1.0f / det;
+
+		// The inverse of the 3x3 part is its adjugate over the determinant
+		float inv[3][3];
+		inv[0][0] = c00 * invDet;
+		inv[1][0] = c01 * invDet;
+		inv[2][0] = c02 * invDet;
+		inv[0][1] = (m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2)) * invDet;
+		inv[1][1] = (m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0)) * invDet;
+		inv[2][1] = (m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1)) * invDet;
+		inv[0][2] = (m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1)) * invDet;
+		inv[1][2] = (m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2)) * invDet;
+		inv[2][2] = (m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)) * invDet;
+
+		// Undo the translation, then the rest: the new translation is -t * inverse
+		AffineTransform result;
+		for (int column = 0; column < 3; column++)
+		{
+			for (int row = 0; row < 3; row++)
+				result.Columns[column][row] = inv[row][column];
+
+			result.Columns[column][3] = -(transform.Columns[0][3] * inv[0][column]
+				+ transform.Columns[1][3] * inv[1][column]
+				+ transform.Columns[2][3] * inv[2][column]);
+		}
+		return result;
+	}
+}
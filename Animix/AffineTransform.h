@@ -0,0 +1,91 @@
+#pragma once
+
+#include "SIMD.h"
+#include "Vector3.h"
+#include "maths/matrix44.h"
+#include "maths/quaternion.h"
+
+
+namespace Animix
+{
+	/**
+	 * A transform without projection: the upper 4x3 of a row-vector gef::Matrix44, whose last column is always (0, 0, 0, 1).
+	 * Stored by column, so that each column holds the rotation and scale in lanes 0-2, and the translation in lane 3.
+	 * Combining two takes three SIMD columns rather than the sixteen dot products of a Matrix44 multiply.
+	 * Joint transforms only use Matrix44 once they reach the renderer.
+	 * Poses keep these in std::vector, which does not honour the 16 byte alignment, so the SIMD paths use unaligned loads and stores
+	 */
+	struct alignas(16) AffineTransform
+	{
+		float Columns[3][4];
+
+		static inline AffineTransform Identity()
+		{
+			return { {
+				{ 1.0f, 0.0f, 0.0f, 0.0f },
+				{ 0.0f, 1.0f, 0.0f, 0.0f },
+				{ 0.0f, 0.0f, 1.0f, 0.0f }
+			} };
+		}
+
+		// The same rotation as gef::Matrix44::Rotation, followed by the translation
+		static inline AffineTransform FromRotationTranslation(const gef::Quaternion& q, const Vector3& t)
+		{
+			const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+			const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+			const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+			return { {
+				{ 1.0f - 2.0f * (yy + zz), 2.0f * (xy - wz), 2.0f * (xz + wy), t.X },
+				{ 2.0f * (xy + wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz - wx), t.Y },
+				{ 2.0f * (xz - wy), 2.0f * (yz + wx), 1.0f - 2.0f * (xx + yy), t.Z }
+			} };
+		}
+
+		// Any projection in the matrix is discarded
+		static AffineTransform FromMatrix(const gef::Matrix44& matrix);
+		void ToMatrix(gef::Matrix44& outMatrix) const;
+		inline gef::Matrix44 ToMatrix() const { gef::Matrix44 matrix; ToMatrix(matrix); return matrix; }
+
+		static AffineTransform Inverse(const AffineTransform& transform);
+
+		// Only rotates and translates; no scale, shear or reflection beyond the tolerance
+		bool IsRigid(float tolerance = 1e-3f) const;
+
+		inline Vector3 GetTranslation() const { return { Columns[0][3], Columns[1][3], Columns[2][3] }; }
+	};
+
+	// Apply a, then b; the equivalent of a * b for row-vector matrices
+	inline AffineTransform operator*(const AffineTransform& a, const AffineTransform& b)
+	{
+		AffineTransform result;
+#if ANIMIX_SSE
+		const __m128 a0 = _mm_loadu_ps(a.Columns[0]);
+		const __m128 a1 = _mm_loadu_ps(a.Columns[1]);
+		const __m128 a2 = _mm_loadu_ps(a.Columns[2]);
+		const __m128 translationLane = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+
+		for (int column = 0; column < 3; column++)
+		{
+			// Row i of the result is a's row i through b; b's translation is only added to the translation row
+			const __m128 bc = _mm_loadu_ps(b.Columns[column]);
+			__m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(0, 0, 0, 0)));
+			r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(1, 1, 1, 1))));
+			r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(2, 2, 2, 2))));
+			r = _mm_add_ps(r, _mm_mul_ps(bc, translationLane));
+			_mm_storeu_ps(result.Columns[column], r);
+		}
+#else
+		for (int column = 0; column < 3; column++)
+		{
+			const float* bc = b.Columns[column];
+			for (int row = 0; row < 4; row++)
+			{
+				result.Columns[column][row] = a.Columns[0][row] * bc[0] + a.Columns[1][row] * bc[1] + a.Columns[2][row] * bc[2]
+					+ (row == 3 ? bc[3] : 0.0f);
+			}
+		}
+#endif
+		return result;
+	}
+}
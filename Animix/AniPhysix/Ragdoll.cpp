@@ -1,7 +1,6 @@
 #include "Ragdoll.h"
 
 #include <cassert>
-#include <d3d10.h>
 
 #include "Animix/Skeleton.h"
 
@@ -86,9 +85,9 @@ namespace AniPhysix
 		}
 	}
 
-	Animix::SkeletonPose Ragdoll::CreatePoseFromSimulation() const
+	void Ragdoll::CreatePoseFromSimulation(Animix::SkeletonPose& outPose) const
 	{
-		Animix::SkeletonPose outPose(m_BindPose.SkID);
+		assert(outPose.SkID == m_BindPose.SkID);
 
 		for (size_t index = 0; index < outPose.GlobalPose.size(); index++)
 		{
@@ -96,7 +95,7 @@ namespace AniPhysix
 			if (m_RigidBodies.find(index) != m_RigidBodies.end())
 			{
 				const auto rb = m_RigidBodies.at(index);
-				outPose.GlobalPose[index] = rb.InvOffsetMatrix * TransformToMatrix(rb.RB->getCenterOfMassTransform());
+				outPose.GlobalPose[index] = Animix::AffineTransform::FromMatrix(rb.InvOffsetMatrix * TransformToMatrix(rb.RB->getCenterOfMassTransform()));
 			}
 			else
 			{
@@ -104,8 +103,6 @@ namespace AniPhysix
 				outPose.GlobalPose[index] = m_BindPose.GlobalPose[index];
 			}
 		}
-
-		return outPose;
 	}
 
 	void Ragdoll::MatchPose(const Animix::SkeletonPose& pose) const
@@ -116,7 +113,7 @@ namespace AniPhysix
 
 			const btTransform prev = rb->getCenterOfMassTransform();
 			const btTransform cur = MatrixToTransform(
-				rigidBodyJoint.second.OffsetMatrix * pose.GlobalPose[rigidBodyJoint.first]
+				rigidBodyJoint.second.OffsetMatrix * pose.GlobalPose[rigidBodyJoint.first].ToMatrix()
 			);
 
 			rb->setCenterOfMassTransform(cur);
@@ -39,7 +39,7 @@ namespace AniPhysix
 
 		// Creates a pose based upon the current position of the simulated rigid bodies
 		// Joints not connected to a rigid body won't be manipulated, therefore pass bind pose into this function to see correct results
-		Animix::SkeletonPose CreatePoseFromSimulation() const;
+		void CreatePoseFromSimulation(Animix::SkeletonPose& outPose) const;
 		// Positions the rigid bodies that make up this ragdoll to match the input pose
 		void MatchPose(const Animix::SkeletonPose& pose) const;
 
@@ -1,84 +1,1105 @@
 #include "AnimationClip.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
 #include "Skeleton.h"
 #include "AnimationEngine.h"
+#include "PoseBlend.h"
 #include "animation/skeleton.h"
 
 namespace Animix
 {
+	namespace
+	{
+		// How many keys to step forward from the cursor before giving up and searching
+		constexpr uint32_t MAX_CURSOR_STEPS = 4;
+
+		/*
+		 * Finds the index of the last key that starts at or before time
+		 * (or the first key, if time is before all keys)
+		 * Key times must be sorted, and there must be at least one key; time is in the same units as the key times
+		 */
+		template<typename TimeType>
+		size_t FindKeyIndex(const TimeType* keyTimes, size_t keyCount, float time, uint32_t* cursor)
+		{
+			const size_t lastKey = keyCount - 1;
+
+			if (cursor)
+			{
+				size_t keyIndex = std::min<size_t>(*cursor, lastKey);
+
+				// The cursor can only be used as a starting point if time has not gone backwards past it
+				// (looping or seeking backwards will invalidate the cursor)
+				if (keyIndex == 0 || time >= keyTimes[keyIndex])
+				{
+					uint32_t steps = 0;
+					for (; steps < MAX_CURSOR_STEPS && keyIndex < lastKey &&
+						time >= keyTimes[keyIndex + 1];
+						keyIndex++, steps++)
+					{}
+
+					// Either the next key starts after time, or there are no more keys
+					if (keyIndex == lastKey || time < keyTimes[keyIndex + 1])
+					{
+						*cursor = static_cast<uint32_t>(keyIndex);
+						return keyIndex;
+					}
+				}
+			}
+
+			// Binary search for the first key (after the first key) that starts after time
+			const TimeType* it = std::upper_bound(keyTimes + 1, keyTimes + keyCount, time);
+			const size_t keyIndex = static_cast<size_t>(it - keyTimes) - 1;
+
+			if (cursor)
+				*cursor = static_cast<uint32_t>(keyIndex);
+			return keyIndex;
+		}
+
+		// As FindKeyIndex, also finding how far time is towards the next key; 0 at the last key
+		template<typename TimeType>
+		size_t FindInterpolatedKey(const TimeType* keyTimes, size_t keyCount, float time, uint32_t* cursor, float& outT)
+		{
+			const size_t keyIndex = FindKeyIndex(keyTimes, keyCount, time, cursor);
+			outT = keyIndex == keyCount - 1
+				? 0.0f
+				: (time - static_cast<float>(keyTimes[keyIndex])) / static_cast<float>(keyTimes[keyIndex + 1] - keyTimes[keyIndex]);
+			return keyIndex;
+		}
+
+		// Widest component of a packed track, and of a smallest-three rotation
+		constexpr uint32_t MAX_PACKED_BITS = 16;
+		constexpr uint32_t MAX_SMALLEST_THREE_BITS = 15;
+		// The smallest three components of a unit quaternion are always within +-1/sqrt(2)
+		constexpr float SMALLEST_THREE_RANGE = 0.70710678f;
+		// Key times further than this from a frame (in frames) are not stored as frames
+		constexpr float FRAME_TOLERANCE = 0.01f;
+
+		/*
+		 * Keys of packed and quantized tracks are streams of bits, with no padding between keys.
+		 * A key is read with a single unaligned 8 byte load, so no key may be wider than 57 bits,
+		 * and the key data must be followed by 8 bytes of padding. Key data is little-endian, as on every platform gef supports
+		 */
+		inline uint64_t ReadBits(const uint8_t* stream, size_t bitOffset)
+		{
+			uint64_t word;
+			memcpy(&word, stream + bitOffset / 8, sizeof(word));
+			return word >> (bitOffset % 8);
+		}
+
+		inline uint32_t ExtractBits(uint64_t key, uint32_t shift, uint32_t bits)
+		{
+			return static_cast<uint32_t>((key >> shift) & ((uint64_t(1) << bits) - 1));
+		}
+
+		// Appends values of up to 57 bits to a stream of bits, lowest bit first
+		class BitWriter
+		{
+		public:
+			void Write(uint64_t value, uint32_t bits)
+			{
+				m_Buffer |= value << m_BufferBits;
+				m_BufferBits += bits;
+				for (; m_BufferBits >= 8; m_BufferBits -= 8)
+				{
+					m_Bytes.push_back(static_cast<uint8_t>(m_Buffer));
+					m_Buffer >>= 8;
+				}
+			}
+
+			// Pads the last byte with zeros
+			std::vector<uint8_t>& Finish()
+			{
+				if (m_BufferBits > 0)
+					m_Bytes.push_back(static_cast<uint8_t>(m_Buffer));
+				m_Buffer = 0;
+				m_BufferBits = 0;
+				return m_Bytes;
+			}
+
+		private:
+			std::vector<uint8_t> m_Bytes;
+			uint64_t m_Buffer = 0;
+			uint32_t m_BufferBits = 0;
+		};
+
+		/*
+		 * Smallest-three encoding of a quaternion in 3 + 3 * bits bits:
+		 * bits 0-1 are the index of the largest component, which is dropped and recovered from the unit length constraint
+		 * bit 2 stores the sign of the largest component, so the decoded quaternion has the same sign as the original
+		 * the three remaining components follow at the given number of bits each
+		 */
+		uint64_t EncodeSmallestThree(const float q[4], uint32_t bits)
+		{
+			// Normalize first; the encoding relies on unit length
+			const float length = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+			const float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+
+			uint32_t largest = 0;
+			for (uint32_t i = 1; i < 4; i++)
+			{
+				if (fabsf(q[i]) > fabsf(q[largest]))
+					largest = i;
+			}
+			// Encode as if the largest component is positive
+			const bool negative = q[largest] < 0.0f;
+			const float sign = negative ? -invLength : invLength;
+			const float maxValue = static_cast<float>((1u << bits) - 1);
+
+			uint64_t packed = largest | (negative ? 4u : 0u);
+			uint32_t shift = 3;
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				if (i == largest)
+					continue;
+
+				const float normalized = (sign * q[i] / SMALLEST_THREE_RANGE) * 0.5f + 0.5f;
+				const float clamped = std::min(std::max(normalized, 0.0f), 1.0f);
+				packed |= static_cast<uint64_t>(clamped * maxValue + 0.5f) << shift;
+				shift += bits;
+			}
+			return packed;
+		}
+
+		gef::Quaternion DecodeSmallestThree(uint64_t packed, uint32_t bits)
+		{
+			const uint32_t largest = packed & 3u;
+			const float maxValue = static_cast<float>((1u << bits) - 1);
+
+			float q[4];
+			float sumSquares = 0.0f;
+			uint32_t shift = 3;
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				if (i == largest)
+					continue;
+
+				const float normalized = static_cast<float>(ExtractBits(packed, shift, bits)) / maxValue;
+				q[i] = (normalized * 2.0f - 1.0f) * SMALLEST_THREE_RANGE;
+				sumSquares += q[i] * q[i];
+				shift += bits;
+			}
+			q[largest] = sqrtf(std::max(1.0f - sumSquares, 0.0f));
+
+			if (packed & 4u)
+				return { -q[0], -q[1], -q[2], -q[3] };
+			return { q[0], q[1], q[2], q[3] };
+		}
+
+		// The header in front of the values of a packed track
+		struct PackedTrackHeader
+		{
+			Vector3 Min;
+			Vector3 Step;
+			uint8_t Bits[3];
+		};
+
+		inline Vector3 UnpackKey(const uint8_t* track, size_t keyIndex)
+		{
+			const PackedTrackHeader* header = reinterpret_cast<const PackedTrackHeader*>(track);
+			const uint32_t bitsX = header->Bits[0], bitsY = header->Bits[1], bitsZ = header->Bits[2];
+			const uint64_t key = ReadBits(track + sizeof(PackedTrackHeader), keyIndex * (bitsX + bitsY + bitsZ));
+
+			return {
+				header->Min.X + static_cast<float>(ExtractBits(key, 0, bitsX)) * header->Step.X,
+				header->Min.Y + static_cast<float>(ExtractBits(key, bitsX, bitsY)) * header->Step.Y,
+				header->Min.Z + static_cast<float>(ExtractBits(key, bitsX + bitsY, bitsZ)) * header->Step.Z
+			};
+		}
+
+		// Recover w from the unit length of a rotation packed with w made positive
+		inline gef::Quaternion UnpackRotation(const Vector3& v)
+		{
+			return { v.X, v.Y, v.Z, sqrtf(std::max(1.0f - v.X * v.X - v.Y * v.Y - v.Z * v.Z, 0.0f)) };
+		}
+
+		// Decode a key of a packed or quantized rotation track
+		gef::Quaternion DecodeRotationKey(const uint8_t* values, const TrackDesc& track, size_t keyIndex)
+		{
+			if (track.Format == TrackFormat::Packed)
+				return UnpackRotation(UnpackKey(values, keyIndex));
+
+			return DecodeSmallestThree(ReadBits(values, keyIndex * (3 + 3 * track.Bits)), track.Bits);
+		}
+
+		// The angle between two rotations
+		// This is calculated from the distance between them, as acos of their dot product is too imprecise for small angles
+		float RotationError(const gef::Quaternion& a, const gef::Quaternion& b)
+		{
+			float same = 0.0f, opposite = 0.0f;
+			const float d[4] = { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
+			const float s[4] = { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
+			for (int i = 0; i < 4; i++)
+			{
+				same += d[i] * d[i];
+				opposite += s[i] * s[i];
+			}
+			const float distance = sqrtf(std::min(same, opposite));
+			return 4.0f * asinf(std::min(0.5f * distance, 1.0f));
+		}
+
+		// The values of a track, encoded as they are written to the key data
+		struct EncodedValues
+		{
+			TrackFormat Format = TrackFormat::Raw;
+			uint8_t Bits = 0;
+			std::vector<uint8_t> Data;
+			float Error = 0.0f;
+		};
+
+		/*
+		 * Pack the three components of each value within the range of the track, at the fewest bits
+		 * for which the error of every decoded value, as measured by error(index, decoded), is within maxError.
+		 * Every component is quantized to the same precision, so components with less range take fewer bits.
+		 * Returns false if even MAX_PACKED_BITS per component is not enough
+		 */
+		template<typename ErrorFunction>
+		bool PackValues(const std::vector<Vector3>& values, float maxError, const ErrorFunction& error, EncodedValues& out)
+		{
+			float min[3] = { values[0].X, values[0].Y, values[0].Z };
+			float max[3] = { values[0].X, values[0].Y, values[0].Z };
+			for (const Vector3& value : values)
+			{
+				const float v[3] = { value.X, value.Y, value.Z };
+				for (int c = 0; c < 3; c++)
+				{
+					min[c] = std::min(min[c], v[c]);
+					max[c] = std::max(max[c], v[c]);
+				}
+			}
+			const float range[3] = { max[0] - min[0], max[1] - min[1], max[2] - min[2] };
+			const float maxRange = std::max(range[0], std::max(range[1], range[2]));
+
+			std::vector<uint32_t> quantized(values.size() * 3);
+			for (uint32_t bits = maxRange > 0.0f ? 1 : 0; bits <= MAX_PACKED_BITS; bits++)
+			{
+				const float precision = bits > 0 ? maxRange / static_cast<float>((1u << bits) - 1) : 0.0f;
+
+				PackedTrackHeader header;
+				header.Min = { min[0], min[1], min[2] };
+				float step[3];
+				for (int c = 0; c < 3; c++)
+				{
+					uint32_t componentBits = 0;
+					while (componentBits < bits && range[c] > precision * static_cast<float>((1u << componentBits) - 1))
+						componentBits++;
+
+					header.Bits[c] = static_cast<uint8_t>(componentBits);
+					step[c] = componentBits > 0 ? range[c] / static_cast<float>((1u << componentBits) - 1) : 0.0f;
+				}
+				header.Step = { step[0], step[1], step[2] };
+
+				// Quantize, and check the error stays within bounds
+				float trackError = 0.0f;
+				for (size_t index = 0; index < values.size() && trackError <= maxError; index++)
+				{
+					const float v[3] = { values[index].X, values[index].Y, values[index].Z };
+					float decoded[3];
+					for (int c = 0; c < 3; c++)
+					{
+						const float maxValue = static_cast<float>((1u << header.Bits[c]) - 1);
+						uint32_t& q = quantized[index * 3 + c];
+						q = step[c] > 0.0f ? static_cast<uint32_t>(std::min((v[c] - min[c]) / step[c] + 0.5f, maxValue)) : 0;
+						decoded[c] = min[c] + static_cast<float>(q) * step[c];
+					}
+					trackError = std::max(trackError, error(index, Vector3{ decoded[0], decoded[1], decoded[2] }));
+				}
+				if (trackError > maxError)
+					continue;
+
+				BitWriter bitWriter;
+				for (size_t index = 0; index < values.size(); index++)
+				{
+					for (int c = 0; c < 3; c++)
+						bitWriter.Write(quantized[index * 3 + c], header.Bits[c]);
+				}
+				const std::vector<uint8_t>& bytes = bitWriter.Finish();
+
+				out.Format = TrackFormat::Packed;
+				out.Error = trackError;
+				out.Data.resize(sizeof(header));
+				memcpy(out.Data.data(), &header, sizeof(header));
+				out.Data.insert(out.Data.end(), bytes.begin(), bytes.end());
+				return true;
+			}
+			return false;
+		}
+
+		EncodedValues EncodePositions(const std::vector<Vector3>& values, const ClipCompressionSettings& settings)
+		{
+			EncodedValues encoded;
+			const auto error = [&values](size_t index, const Vector3& decoded) -> float
+			{
+				const float dx = decoded.X - values[index].X;
+				const float dy = decoded.Y - values[index].Y;
+				const float dz = decoded.Z - values[index].Z;
+				return sqrtf(dx * dx + dy * dy + dz * dz);
+			};
+			if (PackValues(values, settings.MaxPositionError, error, encoded))
+				return encoded;
+
+			encoded.Data.resize(values.size() * sizeof(Vector3));
+			memcpy(encoded.Data.data(), values.data(), encoded.Data.size());
+			return encoded;
+		}
+
+		// Rotations are packed if they can be, falling back to smallest-three, then to full precision
+		EncodedValues EncodeRotations(const std::vector<gef::Quaternion>& values, const ClipCompressionSettings& settings)
+		{
+			// Packing and smallest-three both rely on unit length, and packing on w being positive
+			std::vector<gef::Quaternion> normalized(values.size());
+			std::vector<Vector3> xyz(values.size());
+			for (size_t index = 0; index < values.size(); index++)
+			{
+				const gef::Quaternion& q = values[index];
+				const float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+				const float scale = length > 0.0f ? (q.w < 0.0f ? -1.0f : 1.0f) / length : 0.0f;
+				normalized[index] = { q.x * scale, q.y * scale, q.z * scale, q.w * scale };
+				xyz[index] = { normalized[index].x, normalized[index].y, normalized[index].z };
+			}
+
+			EncodedValues packed;
+			const auto packedError = [&normalized](size_t index, const Vector3& decoded) -> float
+			{
+				return RotationError(normalized[index], UnpackRotation(decoded));
+			};
+			const bool isPacked = PackValues(xyz, settings.MaxRotationError, packedError, packed);
+
+			EncodedValues quantized;
+			for (uint32_t bits = 1; bits <= MAX_SMALLEST_THREE_BITS; bits++)
+			{
+				BitWriter bitWriter;
+				float trackError = 0.0f;
+				for (size_t index = 0; index < values.size() && trackError <= settings.MaxRotationError; index++)
+				{
+					const float q[4] = { normalized[index].x, normalized[index].y, normalized[index].z, normalized[index].w };
+					const uint64_t key = EncodeSmallestThree(q, bits);
+					bitWriter.Write(key, 3 + 3 * bits);
+					trackError = std::max(trackError, RotationError(normalized[index], DecodeSmallestThree(key, bits)));
+				}
+
+				if (trackError <= settings.MaxRotationError)
+				{
+					quantized.Format = TrackFormat::Quantized;
+					quantized.Bits = static_cast<uint8_t>(bits);
+					quantized.Data = std::move(bitWriter.Finish());
+					quantized.Error = trackError;
+					break;
+				}
+			}
+			const bool isQuantized = quantized.Format == TrackFormat::Quantized;
+
+			if (isPacked && (!isQuantized || packed.Data.size() <= quantized.Data.size()))
+				return packed;
+			if (isQuantized)
+				return quantized;
+
+			EncodedValues raw;
+			raw.Data.resize(values.size() * 4 * sizeof(float));
+			float* v = reinterpret_cast<float*>(raw.Data.data());
+			for (const gef::Quaternion& q : values)
+			{
+				*v++ = q.x;
+				*v++ = q.y;
+				*v++ = q.z;
+				*v++ = q.w;
+			}
+			return raw;
+		}
+
+		// Appends data to a key data buffer
+		class KeyDataWriter
+		{
+		public:
+			uint32_t Align(uint32_t alignment)
+			{
+				while (m_Data.size() % alignment)
+					m_Data.push_back(0);
+				return static_cast<uint32_t>(m_Data.size());
+			}
+
+			uint32_t Write(const void* data, size_t size)
+			{
+				const uint32_t offset = static_cast<uint32_t>(m_Data.size());
+				const uint8_t* bytes = static_cast<const uint8_t*>(data);
+				m_Data.insert(m_Data.end(), bytes, bytes + size);
+				return offset;
+			}
+
+			inline std::vector<uint8_t>& GetData() { return m_Data; }
+
+		private:
+			std::vector<uint8_t> m_Data;
+		};
+	}
+
 
 	AnimationClip::AnimationClip(SkeletonID target)
 		: m_Target(target)
 	{
 		const auto skeleton = g_AnimixEngine->GetSkeleton(m_Target);
-		m_JointSamples.resize(skeleton->Joints.size());
+		m_Tracks.resize(skeleton->Joints.size());
+		m_BasePose.resize(skeleton->Joints.size());
 	}
 
-	void AnimationClip::BuildLocalPose(float time, SkeletonPose& outPose) const
+	void AnimationClip::AllocateTracks(const std::vector<uint32_t>& positionKeyCounts, const std::vector<uint32_t>& rotationKeyCounts)
 	{
-		// Get the skeleton from the animation engine
-		const auto skeleton = g_AnimixEngine->GetSkeleton(m_Target);
+		assert(positionKeyCounts.size() == m_Tracks.size() && rotationKeyCounts.size() == m_Tracks.size());
 
-		// Iterate over each joint
-		for (size_t joint = 0; joint < skeleton->Joints.size(); joint++)
+		uint32_t positionKeys = 0;
+		uint32_t rotationKeys = 0;
+		for (size_t joint = 0; joint < m_Tracks.size(); joint++)
 		{
-			const JointSamples& samples = m_JointSamples[joint];
+			positionKeys += positionKeyCounts[joint];
+			rotationKeys += rotationKeyCounts[joint];
+		}
+
+		// Work out where each stream begins
+		// Every stream is made of floats, so every stream remains suitably aligned
+		const uint32_t positionTimes = 0;
+		const uint32_t rotationTimes = positionTimes + positionKeys * sizeof(float);
+		const uint32_t positionValues = rotationTimes + rotationKeys * sizeof(float);
+		const uint32_t rotationValues = positionValues + positionKeys * 3 * sizeof(float);
+		const uint32_t totalSize = rotationValues + rotationKeys * 4 * sizeof(float);
+
+		// Lay out each track within the streams
+		uint32_t positionKeyOffset = 0;
+		uint32_t rotationKeyOffset = 0;
+		for (size_t joint = 0; joint < m_Tracks.size(); joint++)
+		{
+			TrackDesc& position = m_Tracks[joint].Position;
+			position.KeyCount = positionKeyCounts[joint];
+			position.TimeOffset = positionTimes + positionKeyOffset * sizeof(float);
+			position.ValueOffset = positionValues + positionKeyOffset * 3 * sizeof(float);
+			positionKeyOffset += position.KeyCount;
+
+			TrackDesc& rotation = m_Tracks[joint].Rotation;
+			rotation.KeyCount = rotationKeyCounts[joint];
+			rotation.TimeOffset = rotationTimes + rotationKeyOffset * sizeof(float);
+			rotation.ValueOffset = rotationValues + rotationKeyOffset * 4 * sizeof(float);
+			rotationKeyOffset += rotation.KeyCount;
+		}
+
+		m_KeyData.assign(totalSize, 0);
+
+		// Only joints with keys need to be visited when sampling
+		m_AnimatedPositions.clear();
+		m_AnimatedRotations.clear();
+		for (uint32_t joint = 0; joint < m_Tracks.size(); joint++)
+		{
+			if (m_Tracks[joint].Position.KeyCount > 0)
+				m_AnimatedPositions.push_back(joint);
+			if (m_Tracks[joint].Rotation.KeyCount > 0)
+				m_AnimatedRotations.push_back(joint);
+		}
+	}
 
-			Vector3 posePosition;
-			gef::Quaternion poseRotation;
+	void AnimationClip::SetPositionKey(size_t jointIndex, size_t keyIndex, float startTime, const Vector3& value)
+	{
+		const TrackDesc& track = m_Tracks[jointIndex].Position;
+		assert(keyIndex < track.KeyCount);
+
+		GetStream<float>(track.TimeOffset)[keyIndex] = startTime;
+		GetStream<Vector3>(track.ValueOffset)[keyIndex] = value;
+	}
+
+	void AnimationClip::SetRotationKey(size_t jointIndex, size_t keyIndex, float startTime, const gef::Quaternion& value)
+	{
+		const TrackDesc& track = m_Tracks[jointIndex].Rotation;
+		assert(keyIndex < track.KeyCount);
+
+		GetStream<float>(track.TimeOffset)[keyIndex] = startTime;
+
+		float* v = GetStream<float>(track.ValueOffset) + 4 * keyIndex;
+		v[0] = value.x;
+		v[1] = value.y;
+		v[2] = value.z;
+		v[3] = value.w;
+	}
+
+
+	void AnimationClip::MakeAdditive(const SkeletonPose& referencePose)
+	{
+		assert(!m_Additive && m_SampleRate == 0.0f);
+		assert(referencePose.SkID == m_Target);
 
-			if (!samples.PositionKeys.empty())
+		for (size_t joint = 0; joint < m_Tracks.size(); joint++)
+		{
+			const JointTracks& tracks = m_Tracks[joint];
+			assert(tracks.Position.Format == TrackFormat::Raw && tracks.Rotation.Format == TrackFormat::Raw);
+			const JointTransform& reference = referencePose.LocalPose[joint];
+
+			// The difference is stored in the keys themselves, so applying it at runtime needs no reference pose
+			Vector3* positions = GetStream<Vector3>(tracks.Position.ValueOffset);
+			for (size_t key = 0; key < tracks.Position.KeyCount; key++)
+				positions[key] = SubtractJointTransform({ positions[key], reference.Q }, reference).P;
+
+			float* rotations = GetStream<float>(tracks.Rotation.ValueOffset);
+			for (size_t key = 0; key < tracks.Rotation.KeyCount; key++)
 			{
-				// Handle position first
-				// Find the two keys surrounding the given time
-				size_t keyIndex = 0;
-				for (; keyIndex < samples.PositionKeys.size() - 1 &&
-					time >= samples.PositionKeys[keyIndex + 1].StartTime;
-					keyIndex++)
-				{}
+				float* v = rotations + 4 * key;
+				const gef::Quaternion q = SubtractJointTransform({ reference.P, gef::Quaternion(v[0], v[1], v[2], v[3]) }, reference).Q;
+				v[0] = q.x;
+				v[1] = q.y;
+				v[2] = q.z;
+				v[3] = q.w;
+			}
 
-				const PositionKey& startKey = samples.PositionKeys[keyIndex];
-				if (keyIndex == samples.PositionKeys.size() - 1)
-				{
-					posePosition = startKey.Value;
-				}
-				else
-				{
-					const PositionKey& endKey = samples.PositionKeys[keyIndex + 1];
+			m_BasePose[joint] = { Vector3(), gef::Quaternion(0.0f, 0.0f, 0.0f, 1.0f) };
+		}
 
-					const float t = (time - startKey.StartTime) / (endKey.StartTime - startKey.StartTime);
-					posePosition = Vector3::Lerp(startKey.Value, endKey.Value, t);
-				}
+		m_Additive = true;
+	}
+
+	void AnimationClip::ExtractConstantTracks()
+	{
+		assert(!IsResampled());
+
+		// A track is constant if every key has exactly the same value as the first
+		const auto isConstant = [this](const TrackDesc& track, size_t valueSize) -> bool
+		{
+			const uint8_t* values = m_KeyData.data() + track.ValueOffset;
+			for (size_t key = 1; key < track.KeyCount; key++)
+			{
+				if (memcmp(values, values + key * valueSize, valueSize) != 0)
+					return false;
 			}
+			return track.KeyCount > 0;
+		};
+
+		// Constant tracks never change, so their value becomes part of the base pose
+		std::vector<uint32_t> positionKeyCounts(m_Tracks.size(), 0);
+		std::vector<uint32_t> rotationKeyCounts(m_Tracks.size(), 0);
+		for (size_t joint = 0; joint < m_Tracks.size(); joint++)
+		{
+			const JointTracks& tracks = m_Tracks[joint];
+			assert(tracks.Position.Format == TrackFormat::Raw && tracks.Rotation.Format == TrackFormat::Raw);
+
+			if (isConstant(tracks.Position, 3 * sizeof(float)))
+				m_BasePose[joint].P = GetPositionKey(tracks.Position, 0);
+			else
+				positionKeyCounts[joint] = tracks.Position.KeyCount;
+
+			if (isConstant(tracks.Rotation, 4 * sizeof(float)))
+				m_BasePose[joint].Q = GetRotationKey(tracks.Rotation, 0);
+			else
+				rotationKeyCounts[joint] = tracks.Rotation.KeyCount;
+		}
+
+		// Repack the key data with only the animated tracks
+		const std::vector<JointTracks> oldTracks = m_Tracks;
+		const std::vector<uint8_t> oldKeyData = std::move(m_KeyData);
+		AllocateTracks(positionKeyCounts, rotationKeyCounts);
 
-			if (!samples.RotationKeys.empty())
+		const auto copyTrack = [&](const TrackDesc& source, const TrackDesc& dest, size_t valueSize)
+		{
+			memcpy(m_KeyData.data() + dest.TimeOffset, oldKeyData.data() + source.TimeOffset, dest.KeyCount * sizeof(float));
+			memcpy(m_KeyData.data() + dest.ValueOffset, oldKeyData.data() + source.ValueOffset, dest.KeyCount * valueSize);
+		};
+		for (size_t joint = 0; joint < m_Tracks.size(); joint++)
+		{
+			copyTrack(oldTracks[joint].Position, m_Tracks[joint].Position, 3 * sizeof(float));
+			copyTrack(oldTracks[joint].Rotation, m_Tracks[joint].Rotation, 4 * sizeof(float));
+		}
+	}
+
+
+	float AnimationClip::FindKeyFrameRate() const
+	{
+		// The shortest gap between two keys is taken to be a frame
+		float frameTime = 0.0f;
+		const auto findFrameTime = [this, &frameTime](const TrackDesc& track)
+		{
+			const float* times = GetStream<float>(track.TimeOffset);
+			for (size_t key = 1; key < track.KeyCount; key++)
+			{
+				const float gap = times[key] - times[key - 1];
+				if (gap > 0.0f && (frameTime == 0.0f || gap < frameTime))
+					frameTime = gap;
+			}
+		};
+		for (const JointTracks& tracks : m_Tracks)
+		{
+			findFrameTime(tracks.Position);
+			findFrameTime(tracks.Rotation);
+		}
+		if (frameTime == 0.0f)
+			return 0.0f;
+
+		// Key times are rounded to floats, so snap to whole rates such as 30 frames per second
+		float frameRate = 1.0f / frameTime;
+		if (fabsf(frameRate - roundf(frameRate)) < 1e-3f * frameRate)
+			frameRate = roundf(frameRate);
+
+		// Every key must then lie on a frame
+		const auto onFrames = [this, frameRate](const TrackDesc& track) -> bool
+		{
+			const float* times = GetStream<float>(track.TimeOffset);
+			for (size_t key = 0; key < track.KeyCount; key++)
 			{
-				// Handle position first
-				// Find the two keys surrounding the given time
-				size_t keyIndex = 0;
-				for (; keyIndex < samples.RotationKeys.size() - 1 &&
-					time >= samples.RotationKeys[keyIndex + 1].StartTime;
-					keyIndex++)
+				const float frame = times[key] * frameRate;
+				if (frame < 0.0f || frame > static_cast<float>(UINT16_MAX) || fabsf(frame - roundf(frame)) > FRAME_TOLERANCE)
+					return false;
+			}
+			return true;
+		};
+		for (const JointTracks& tracks : m_Tracks)
+		{
+			if (!onFrames(tracks.Position) || !onFrames(tracks.Rotation))
+				return 0.0f;
+		}
+		return frameRate;
+	}
+
+	void AnimationClip::Compress(const ClipCompressionSettings& settings, ClipCompressionReport* outReport)
+	{
+		ClipCompressionReport report;
+		report.UncompressedSize = m_KeyData.size();
+
+		// Keys exported from animation tools lie on frames, so their times can be stored as 16 bit frames
+		// Resampled clips have a key on every frame already
+		const float frameRate = IsResampled() ? m_SampleRate : FindKeyFrameRate();
+
+		// How each track will be written
+		struct TrackEncoding
+		{
+			EncodedValues Values;
+			KeyTimeFormat Times = KeyTimeFormat::Seconds;
+			uint32_t KeyCount = 0;
+			std::vector<uint16_t> Frames;
+		};
+		std::vector<TrackEncoding> positions(m_Tracks.size());
+		std::vector<TrackEncoding> rotations(m_Tracks.size());
+
+		// The frame of each key of a track; true if there is a key on every frame
+		const auto findFrames = [this, frameRate](const TrackDesc& source, std::vector<uint16_t>& outFrames) -> bool
+		{
+			const float* times = GetStream<float>(source.TimeOffset);
+			outFrames.resize(source.KeyCount);
+			bool everyFrame = true;
+			for (size_t key = 0; key < source.KeyCount; key++)
+			{
+				outFrames[key] = static_cast<uint16_t>(roundf(times[key] * frameRate));
+				everyFrame &= outFrames[key] == key;
+			}
+			return everyFrame;
+		};
+
+		// A track missing keys on some frames, as after key reduction, stores the frame of each of its keys
+		// Sampling it on every frame instead adds keys but needs no times, and is kept if it takes less space
+		for (size_t joint = 0; joint < m_Tracks.size(); joint++)
+		{
+			const TrackDesc& source = m_Tracks[joint].Position;
+			TrackEncoding& encoding = positions[joint];
+			if (source.KeyCount == 0)
+				continue;
+
+			std::vector<Vector3> values(source.KeyCount);
+			for (size_t key = 0; key < source.KeyCount; key++)
+				values[key] = GetPositionKey(source, key);
+			encoding.Values = EncodePositions(values, settings);
+			encoding.KeyCount = source.KeyCount;
+
+			if (IsResampled() || (frameRate > 0.0f && findFrames(source, encoding.Frames)))
+			{
+				encoding.Times = KeyTimeFormat::EveryFrame;
+			}
+			else if (frameRate > 0.0f)
+			{
+				encoding.Times = KeyTimeFormat::Frames;
+
+				std::vector<Vector3> frameValues(encoding.Frames.back() + 1);
+				uint32_t cursor = 0;
+				for (size_t frame = 0; frame < frameValues.size(); frame++)
+					frameValues[frame] = SamplePositionTrack(source, static_cast<float>(frame) / frameRate, &cursor);
+
+				EncodedValues everyFrame = EncodePositions(frameValues, settings);
+				if (everyFrame.Data.size() <= encoding.Values.Data.size() + encoding.Frames.size() * sizeof(uint16_t))
 				{
+					encoding.Values = std::move(everyFrame);
+					encoding.Times = KeyTimeFormat::EveryFrame;
+					encoding.KeyCount = static_cast<uint32_t>(frameValues.size());
 				}
+			}
+		}
+
+		for (size_t joint = 0; joint < m_Tracks.size(); joint++)
+		{
+			const TrackDesc& source = m_Tracks[joint].Rotation;
+			TrackEncoding& encoding = rotations[joint];
+			if (source.KeyCount == 0)
+				continue;
+
+			std::vector<gef::Quaternion> values(source.KeyCount);
+			for (size_t key = 0; key < source.KeyCount; key++)
+				values[key] = GetRotationKey(source, key);
+			encoding.Values = EncodeRotations(values, settings);
+			encoding.KeyCount = source.KeyCount;
+
+			if (IsResampled() || (frameRate > 0.0f && findFrames(source, encoding.Frames)))
+			{
+				encoding.Times = KeyTimeFormat::EveryFrame;
+			}
+			else if (frameRate > 0.0f)
+			{
+				encoding.Times = KeyTimeFormat::Frames;
 
-				const RotationKey& startKey = samples.RotationKeys[keyIndex];
-				if (keyIndex == samples.RotationKeys.size() - 1)
+				std::vector<gef::Quaternion> frameValues(encoding.Frames.back() + 1);
+				uint32_t cursor = 0;
+				for (size_t frame = 0; frame < frameValues.size(); frame++)
+					frameValues[frame] = SampleRotationTrack(source, static_cast<float>(frame) / frameRate, &cursor);
+
+				EncodedValues everyFrame = EncodeRotations(frameValues, settings);
+				if (everyFrame.Data.size() <= encoding.Values.Data.size() + encoding.Frames.size() * sizeof(uint16_t))
 				{
-					poseRotation = startKey.Value;
+					encoding.Values = std::move(everyFrame);
+					encoding.Times = KeyTimeFormat::EveryFrame;
+					encoding.KeyCount = static_cast<uint32_t>(frameValues.size());
 				}
-				else
-				{
-					const RotationKey& endKey = samples.RotationKeys[keyIndex + 1];
+			}
+		}
+
+		std::vector<JointTracks> tracks(m_Tracks.size());
+		KeyDataWriter writer;
+
+		// Key times are written first
+		// Tracks with identical key times (which is typical for sampled animation) share a single copy,
+		// so remember which times have already been written, and where to
+		struct SharedTimes
+		{
+			KeyTimeFormat Times;
+			uint32_t Offset;
+			size_t Size;
+		};
+		std::vector<SharedTimes> sharedTimes;
+		const auto writeTrackTimes = [&](const TrackDesc& source, const TrackEncoding& encoding, TrackDesc& dest)
+		{
+			dest.Times = encoding.Times;
+			if (encoding.Times == KeyTimeFormat::EveryFrame)
+				return;
 
-					const float t = (time - startKey.StartTime) / (endKey.StartTime - startKey.StartTime);
-					poseRotation.Slerp(startKey.Value, endKey.Value, t);
+			const bool frames = encoding.Times == KeyTimeFormat::Frames;
+			const void* times = frames ? static_cast<const void*>(encoding.Frames.data()) : GetStream<float>(source.TimeOffset);
+			const size_t size = encoding.KeyCount * (frames ? sizeof(uint16_t) : sizeof(float));
+
+			for (const SharedTimes& shared : sharedTimes)
+			{
+				if (shared.Times == encoding.Times && shared.Size == size && memcmp(writer.GetData().data() + shared.Offset, times, size) == 0)
+				{
+					dest.TimeOffset = shared.Offset;
+					return;
 				}
 			}
 
-			// Construct local pose matrix from position and rotation
-			outPose.LocalPose[joint].P = posePosition;
-			outPose.LocalPose[joint].Q = poseRotation;
+			writer.Align(frames ? alignof(uint16_t) : alignof(float));
+			dest.TimeOffset = writer.Write(times, size);
+			sharedTimes.push_back({ encoding.Times, dest.TimeOffset, size });
+		};
+		for (size_t joint = 0; joint < m_Tracks.size(); joint++)
+		{
+			if (positions[joint].KeyCount > 0)
+				writeTrackTimes(m_Tracks[joint].Position, positions[joint], tracks[joint].Position);
+			if (rotations[joint].KeyCount > 0)
+				writeTrackTimes(m_Tracks[joint].Rotation, rotations[joint], tracks[joint].Rotation);
 		}
+
+		// Then position values, then rotation values
+		const auto writeTrackValues = [&](const TrackEncoding& encoding, TrackDesc& dest, float& maxError)
+		{
+			dest.KeyCount = encoding.KeyCount;
+			dest.Format = encoding.Values.Format;
+			dest.Bits = encoding.Values.Bits;
+			dest.ValueOffset = writer.Align(dest.Format == TrackFormat::Quantized ? 1 : alignof(float));
+			writer.Write(encoding.Values.Data.data(), encoding.Values.Data.size());
+
+			if (dest.Format == TrackFormat::Raw)
+			{
+				report.RawTracks++;
+			}
+			else
+			{
+				maxError = std::max(maxError, encoding.Values.Error);
+				report.QuantizedTracks++;
+			}
+		};
+		for (size_t joint = 0; joint < m_Tracks.size(); joint++)
+		{
+			if (positions[joint].KeyCount > 0)
+				writeTrackValues(positions[joint], tracks[joint].Position, report.MaxPositionError);
+		}
+		for (size_t joint = 0; joint < m_Tracks.size(); joint++)
+		{
+			if (rotations[joint].KeyCount > 0)
+				writeTrackValues(rotations[joint], tracks[joint].Rotation, report.MaxRotationError);
+		}
+
+		// Packed keys are read 8 bytes at a time, which may run past the end of the last key
+		const uint64_t padding = 0;
+		writer.Write(&padding, sizeof(padding));
+
+		// Replace the clip data
+		m_Tracks = std::move(tracks);
+		m_KeyData = std::move(writer.GetData());
+		m_KeyData.shrink_to_fit();
+		m_KeyFrameRate = frameRate;
+
+		report.CompressedSize = m_KeyData.size();
+		if (outReport)
+			*outReport = report;
+	}
+
+
+	// Keys are decoded and sampled for every animated track of every pose, so these are inline to save a call per key
+	inline Vector3 AnimationClip::GetPositionKey(const TrackDesc& track, size_t keyIndex) const
+	{
+		if (track.Format == TrackFormat::Packed)
+			return UnpackKey(GetStream<uint8_t>(track.ValueOffset), keyIndex);
+
+		return GetStream<Vector3>(track.ValueOffset)[keyIndex];
+	}
+
+	inline gef::Quaternion AnimationClip::GetRotationKey(const TrackDesc& track, size_t keyIndex) const
+	{
+		// Decoding takes longer than a call, so only full precision keys are read inline
+		if (track.Format != TrackFormat::Raw)
+			return DecodeRotationKey(GetStream<uint8_t>(track.ValueOffset), track, keyIndex);
+
+		const float* v = GetStream<float>(track.ValueOffset) + 4 * keyIndex;
+		return { v[0], v[1], v[2], v[3] };
+	}
+
+
+	inline size_t AnimationClip::FindTrackKey(const TrackDesc& track, float time, uint32_t* cursor, float& outT) const
+	{
+		if (track.Times == KeyTimeFormat::EveryFrame)
+		{
+			// The key is found directly from the time
+			const size_t lastKey = track.KeyCount - 1;
+			const float frame = std::max(time * m_KeyFrameRate, 0.0f);
+			const size_t keyIndex = std::min(static_cast<size_t>(frame), lastKey);
+			outT = keyIndex == lastKey ? 0.0f : frame - static_cast<float>(keyIndex);
+			return keyIndex;
+		}
+
+		if (track.Times == KeyTimeFormat::Frames)
+			return FindInterpolatedKey(GetStream<uint16_t>(track.TimeOffset), track.KeyCount, time * m_KeyFrameRate, cursor, outT);
+
+		return FindInterpolatedKey(GetStream<float>(track.TimeOffset), track.KeyCount, time, cursor, outT);
+	}
+
+	inline Vector3 AnimationClip::SamplePositionTrack(const TrackDesc& track, float time, uint32_t* cursor) const
+	{
+		// Find the two keys surrounding the given time
+		float t;
+		const size_t keyIndex = FindTrackKey(track, time, cursor, t);
+
+		if (keyIndex == track.KeyCount - 1)
+			return GetPositionKey(track, keyIndex);
+
+		return Vector3::Lerp(GetPositionKey(track, keyIndex), GetPositionKey(track, keyIndex + 1), t);
+	}
+
+	inline gef::Quaternion AnimationClip::SampleRotationTrack(const TrackDesc& track, float time, uint32_t* cursor) const
+	{
+		// Find the two keys surrounding the given time
+		float t;
+		const size_t keyIndex = FindTrackKey(track, time, cursor, t);
+
+		if (keyIndex == track.KeyCount - 1)
+			return GetRotationKey(track, keyIndex);
+
+		gef::Quaternion rotation;
+		rotation.Slerp(GetRotationKey(track, keyIndex), GetRotationKey(track, keyIndex + 1), t);
+		return rotation;
+	}
+
+
+	void AnimationClip::Resample(float sampleRate)
+	{
+		assert(sampleRate > 0.0f && m_SampleRate == 0.0f);
+
+		// Enough frames to cover the whole clip; the final frame lies at or after the end of the clip
+		const uint32_t frameCount = static_cast<uint32_t>(ceilf(m_Duration * sampleRate)) + 1;
+
+		std::vector<JointTracks> tracks = m_Tracks;
+		KeyDataWriter writer;
+
+		// Resampled clips do not require any key times; the key index is calculated from the time instead
+		// Tracks with only one key do not change over time, so they do not need to be resampled
+		for (size_t joint = 0; joint < m_Tracks.size(); joint++)
+		{
+			const TrackDesc& source = m_Tracks[joint].Position;
+			TrackDesc& dest = tracks[joint].Position;
+			if (source.KeyCount == 0)
+				continue;
+
+			dest.TimeOffset = 0;
+			dest.Times = KeyTimeFormat::EveryFrame;
+			dest.ValueOffset = writer.Align(alignof(float));
+			dest.Format = TrackFormat::Raw;
+
+			if (source.KeyCount == 1)
+			{
+				const Vector3 value = GetPositionKey(source, 0);
+				writer.Write(&value, sizeof(Vector3));
+				continue;
+			}
+
+			dest.KeyCount = frameCount;
+			uint32_t cursor = 0;
+			for (uint32_t frame = 0; frame < frameCount; frame++)
+			{
+				const Vector3 value = SamplePositionTrack(source, static_cast<float>(frame) / sampleRate, &cursor);
+				writer.Write(&value, sizeof(Vector3));
+			}
+		}
+
+		for (size_t joint = 0; joint < m_Tracks.size(); joint++)
+		{
+			const TrackDesc& source = m_Tracks[joint].Rotation;
+			TrackDesc& dest = tracks[joint].Rotation;
+			if (source.KeyCount == 0)
+				continue;
+
+			dest.TimeOffset = 0;
+			dest.Times = KeyTimeFormat::EveryFrame;
+			dest.ValueOffset = writer.Align(alignof(float));
+			dest.Format = TrackFormat::Raw;
+
+			if (source.KeyCount > 1)
+				dest.KeyCount = frameCount;
+
+			uint32_t cursor = 0;
+			for (uint32_t frame = 0; frame < dest.KeyCount; frame++)
+			{
+				const gef::Quaternion value = SampleRotationTrack(source, static_cast<float>(frame) / sampleRate, &cursor);
+				const float v[4] = { value.x, value.y, value.z, value.w };
+				writer.Write(v, sizeof(v));
+			}
+		}
+
+		m_Tracks = std::move(tracks);
+		m_KeyData = std::move(writer.GetData());
+		m_KeyData.shrink_to_fit();
+
+		m_SampleRate = sampleRate;
+		m_FrameCount = frameCount;
+		m_KeyFrameRate = sampleRate;
+	}
+
+
+	void AnimationClip::BuildLocalPose(float time, SkeletonPose& outPose, KeyCursorCache* cursors) const
+	{
+		if (outPose.Mask)
+		{
+			BuildLocalPoseMasked(time, outPose, cursors);
+			return;
+		}
+
+		// Joints without animated tracks take their values from the base pose
+		std::copy(m_BasePose.begin(), m_BasePose.end(), outPose.LocalPose.begin());
+
+		if (m_SampleRate > 0.0f)
+		{
+			// Resampled clips do not need to search for keys
+			BuildLocalPoseResampled(time, outPose);
+			return;
+		}
+
+		if (cursors && cursors->PositionCursors.size() != m_Tracks.size())
+		{
+			// The cache was made for a different clip (or has never been used)
+			cursors->PositionCursors.assign(m_Tracks.size(), 0);
+			cursors->RotationCursors.assign(m_Tracks.size(), 0);
+		}
+
+		// Handle position first
+		for (const uint32_t joint : m_AnimatedPositions)
+			outPose.LocalPose[joint].P = SamplePositionTrack(m_Tracks[joint].Position, time, cursors ? &cursors->PositionCursors[joint] : nullptr);
+
+		// Then handle rotation
+		for (const uint32_t joint : m_AnimatedRotations)
+			outPose.LocalPose[joint].Q = SampleRotationTrack(m_Tracks[joint].Rotation, time, cursors ? &cursors->RotationCursors[joint] : nullptr);
+	}
+
+	void AnimationClip::BuildLocalPoseResampled(float time, SkeletonPose& outPose) const
+	{
+		// Every animated track has a value for every frame, so the frames either side of time are the same for all tracks
+		size_t frame0, frame1;
+		float t;
+		FindResampledFrames(time, frame0, frame1, t);
+
+		for (const uint32_t joint : m_AnimatedPositions)
+			outPose.LocalPose[joint].P = SampleResampledPosition(m_Tracks[joint].Position, frame0, frame1, t);
+
+		for (const uint32_t joint : m_AnimatedRotations)
+			outPose.LocalPose[joint].Q = SampleResampledRotation(m_Tracks[joint].Rotation, frame0, frame1, t);
+	}
+
+	void AnimationClip::BuildLocalPoseMasked(float time, SkeletonPose& outPose, KeyCursorCache* cursors) const
+	{
+		// A mask usually covers a subtree, such as the upper body, so visiting only its joints skips most of the clip
+		size_t frame0 = 0, frame1 = 0;
+		float t = 0.0f;
+		if (m_SampleRate > 0.0f)
+		{
+			FindResampledFrames(time, frame0, frame1, t);
+		}
+		else if (cursors && cursors->PositionCursors.size() != m_Tracks.size())
+		{
+			cursors->PositionCursors.assign(m_Tracks.size(), 0);
+			cursors->RotationCursors.assign(m_Tracks.size(), 0);
+		}
+
+		for (const uint32_t joint : outPose.Mask->Joints)
+		{
+			const JointTracks& tracks = m_Tracks[joint];
+			JointTransform& transform = outPose.LocalPose[joint];
+			transform = m_BasePose[joint];
+
+			if (tracks.Position.KeyCount > 0)
+			{
+				transform.P = m_SampleRate > 0.0f
+					? SampleResampledPosition(tracks.Position, frame0, frame1, t)
+					: SamplePositionTrack(tracks.Position, time, cursors ? &cursors->PositionCursors[joint] : nullptr);
+			}
+
+			if (tracks.Rotation.KeyCount > 0)
+			{
+				transform.Q = m_SampleRate > 0.0f
+					? SampleResampledRotation(tracks.Rotation, frame0, frame1, t)
+					: SampleRotationTrack(tracks.Rotation, time, cursors ? &cursors->RotationCursors[joint] : nullptr);
+			}
+		}
+	}
+
+	void AnimationClip::FindResampledFrames(float time, size_t& outFrame0, size_t& outFrame1, float& outT) const
+	{
+		const float frame = std::max(time * m_SampleRate, 0.0f);
+		const size_t lastFrame = m_FrameCount - 1;
+		outFrame0 = std::min(static_cast<size_t>(frame), lastFrame);
+		outFrame1 = std::min(outFrame0 + 1, lastFrame);
+		outT = outFrame0 == lastFrame ? 0.0f : frame - static_cast<float>(outFrame0);
+	}
+
+	// Tracks with a single key are only present if constant tracks were not extracted before resampling
+	Vector3 AnimationClip::SampleResampledPosition(const TrackDesc& track, size_t frame0, size_t frame1, float t) const
+	{
+		if (track.KeyCount == 1)
+			return GetPositionKey(track, 0);
+		return Vector3::Lerp(GetPositionKey(track, frame0), GetPositionKey(track, frame1), t);
+	}
+
+	gef::Quaternion AnimationClip::SampleResampledRotation(const TrackDesc& track, size_t frame0, size_t frame1, float t) const
+	{
+		if (track.KeyCount == 1)
+			return GetRotationKey(track, 0);
+
+		gef::Quaternion result;
+		result.Slerp(GetRotationKey(track, frame0), GetRotationKey(track, frame1), t);
+		return result;
 	}
 }
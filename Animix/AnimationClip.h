@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include "Skeleton.h"
@@ -32,13 +33,91 @@ namespace Animix
 		float Value;
 	};
 
+	// How the values of a track are encoded in the key data
+	enum class TrackFormat : uint8_t
+	{
+		// Full precision floats
+		Raw,
+		// Rotations only: smallest-three quaternions, at TrackDesc::Bits per component
+		Quantized,
+		// Each component within the range of the track, at the fewest bits that meet the error bound
+		// Rotations store x, y and z with w made positive, and recover w from the unit length
+		Packed
+	};
+
+	// How the key times of a track are stored in the key data
+	enum class KeyTimeFormat : uint8_t
+	{
+		// A float per key, in seconds
+		Seconds,
+		// A uint16_t per key, in frames at the clip's key frame rate
+		Frames,
+		// A key on every frame at the clip's key frame rate, so no times are stored
+		EveryFrame
+	};
+
+	/**
+	 * Describes where the keys of a single track live within a clip's key data.
+	 * Offsets are in bytes from the start of the key data
+	 */
+	struct TrackDesc
+	{
+		uint32_t KeyCount = 0;
+		uint32_t TimeOffset = 0;
+		uint32_t ValueOffset = 0;
+		TrackFormat Format = TrackFormat::Raw;
+		KeyTimeFormat Times = KeyTimeFormat::Seconds;
+		// Bits per component of a quantized rotation
+		uint8_t Bits = 0;
+	};
+
+	/**
+	 * The tracks that animate a single joint
+	 */
+	struct JointTracks
+	{
+		TrackDesc Position;
+		TrackDesc Rotation;
+	};
+
+	/**
+	 * Controls how much precision may be lost when compressing a clip.
+	 * Any track that cannot be quantized within these bounds is left at full precision
+	 */
+	struct ClipCompressionSettings
+	{
+		// Maximum distance any position key may move, in the same units as the skeleton
+		float MaxPositionError = 0.01f;
+		// Maximum angle (radians) between any rotation key and its quantized value
+		float MaxRotationError = 0.001f;
+	};
+
 	/**
-	 * All of the animation data for a single joint
+	 * Results of compressing a clip
 	 */
-	struct JointSamples
+	struct ClipCompressionReport
 	{
-		std::vector<PositionKey> PositionKeys;
-		std::vector<RotationKey> RotationKeys;
+		size_t UncompressedSize = 0;
+		size_t CompressedSize = 0;
+
+		// The largest error introduced into any key
+		float MaxPositionError = 0.0f;
+		float MaxRotationError = 0.0f;
+
+		// Tracks that could not meet the error bounds and were kept at full precision
+		uint32_t RawTracks = 0;
+		uint32_t QuantizedTracks = 0;
+	};
+
+	/**
+	 * Remembers which key was last used in each track of a clip.
+	 * Samplers play clips forwards most of the time, so the next key is almost always
+	 * the same key or the one after it; starting the search from here avoids scanning from the first key
+	 */
+	struct KeyCursorCache
+	{
+		std::vector<uint32_t> PositionCursors;
+		std::vector<uint32_t> RotationCursors;
 	};
 
 
@@ -47,15 +126,77 @@ namespace Animix
 	public:
 		AnimationClip(SkeletonID target);
 
-		void BuildLocalPose(float time, SkeletonPose& outPose) const;
+		// The cursor cache is optional, but should be provided whenever the clip is sampled repeatedly by the same sampler
+		// If the pose has a joint mask, only the masked joints are sampled
+		void BuildLocalPose(float time, SkeletonPose& outPose, KeyCursorCache* cursors = nullptr) const;
 
 		// Getters
 		inline SkeletonID GetTarget() const { return m_Target; }
 		inline float GetDuration() const { return m_Duration; }
 
+		inline size_t GetKeyDataSize() const { return m_KeyData.size(); }
+		// Resampled clips have a value for each frame, rather than keys placed at arbitrary times
+		inline bool IsResampled() const { return m_SampleRate > 0.0f; }
+		inline float GetSampleRate() const { return m_SampleRate; }
+		// Additive clips hold the difference from a reference pose, to be applied by an AdditiveBlendNode
+		inline bool IsAdditive() const { return m_Additive; }
+
 		// Setters; only to be used in constructing the animation
 		inline void SetDuration(float duration) { m_Duration = duration; }
-		inline void SetJointSamples(size_t jointIndex, JointSamples&& samples) { m_JointSamples[jointIndex] = std::move(samples); }
+
+		// The number of keys in every track must be known up front, so that all key data can be allocated at once
+		// Each vector holds a key count for each joint in the target skeleton
+		void AllocateTracks(const std::vector<uint32_t>& positionKeyCounts, const std::vector<uint32_t>& rotationKeyCounts);
+		// Keys must be set in order of start time
+		void SetPositionKey(size_t jointIndex, size_t keyIndex, float startTime, const Vector3& value);
+		void SetRotationKey(size_t jointIndex, size_t keyIndex, float startTime, const gef::Quaternion& value);
+
+		// Convert every key into its difference from the reference pose, so the clip can be layered on top of other animation
+		// Joints without keys are given no difference
+		// Should be called only once, after all keys have been set, and before extracting constant tracks, resampling or compressing
+		void MakeAdditive(const SkeletonPose& referencePose);
+
+		// Move the values of tracks that never change into the clip's base pose, so that only animated tracks are sampled
+		// Should be called only once, after all keys have been set, and before resampling or compressing
+		void ExtractConstantTracks();
+
+		// Replace the keys of every animated track with values sampled at a fixed rate (frames per second)
+		// Sampling then calculates which frames to use directly from the time, instead of searching for keys
+		// Should be called only once, after all keys have been set, and before compressing
+		void Resample(float sampleRate);
+
+		// Re-encode all keys with quantized values at the fewest bits that meet the error bounds
+		// Key times become 16 bit frames if every key lies on a frame, and identical key times are shared between tracks
+		// A track with keys removed by key reduction is sampled back onto every frame if that takes less space than storing its key times
+		// Should be called only once, after all keys have been set
+		void Compress(const ClipCompressionSettings& settings, ClipCompressionReport* outReport = nullptr);
+
+	private:
+		// Decode a single key from a track
+		Vector3 GetPositionKey(const TrackDesc& track, size_t keyIndex) const;
+		gef::Quaternion GetRotationKey(const TrackDesc& track, size_t keyIndex) const;
+
+		// The key to interpolate from at time, and how far time is towards the next key
+		size_t FindTrackKey(const TrackDesc& track, float time, uint32_t* cursor, float& outT) const;
+		// The rate at which every key time lies on a frame, or 0 if there is none with frames that fit in 16 bits
+		float FindKeyFrameRate() const;
+
+		// Sample a single track of a clip with keys placed at arbitrary times
+		Vector3 SamplePositionTrack(const TrackDesc& track, float time, uint32_t* cursor) const;
+		gef::Quaternion SampleRotationTrack(const TrackDesc& track, float time, uint32_t* cursor) const;
+
+		void BuildLocalPoseResampled(float time, SkeletonPose& outPose) const;
+		void BuildLocalPoseMasked(float time, SkeletonPose& outPose, KeyCursorCache* cursors) const;
+
+		// The frames either side of time in a resampled clip, and how far time is between them
+		void FindResampledFrames(float time, size_t& outFrame0, size_t& outFrame1, float& outT) const;
+		Vector3 SampleResampledPosition(const TrackDesc& track, size_t frame0, size_t frame1, float t) const;
+		gef::Quaternion SampleResampledRotation(const TrackDesc& track, size_t frame0, size_t frame1, float t) const;
+
+		template<typename T>
+		inline T* GetStream(uint32_t offset) { return reinterpret_cast<T*>(m_KeyData.data() + offset); }
+		template<typename T>
+		inline const T* GetStream(uint32_t offset) const { return reinterpret_cast<const T*>(m_KeyData.data() + offset); }
 
 	private:
 		// Animation clips are made for a particular skeleton
@@ -63,7 +204,29 @@ namespace Animix
 
 		// Animation data
 		float m_Duration = 0.0f;
-		std::vector<JointSamples> m_JointSamples;
+
+		// Frames per second of a resampled clip, or 0 if the clip has not been resampled
+		float m_SampleRate = 0.0f;
+		uint32_t m_FrameCount = 0;
+		// Frames per second of key times stored as frames
+		float m_KeyFrameRate = 0.0f;
+
+		bool m_Additive = false;
+
+		// Where each joint's tracks are within the key data
+		std::vector<JointTracks> m_Tracks;
+
+		// Joints that have keys in the key data; only these joints are visited when sampling
+		std::vector<uint32_t> m_AnimatedPositions;
+		std::vector<uint32_t> m_AnimatedRotations;
+		// Values of joints that are not animated: either a constant track's value, or the default transform for joints without keys
+		std::vector<JointTransform> m_BasePose;
+
+		// All keys in the clip are packed into one allocation, laid out as separate streams:
+		// position times, rotation times, position values, then rotation values.
+		// Within each stream, the keys of each track are contiguous (compressed clips may also share times between tracks, or store none)
+		// This means a key search only touches the times of a single track, and sampling a pose walks through memory in order
+		std::vector<uint8_t> m_KeyData;
 	};
 
 }
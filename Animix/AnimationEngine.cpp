@@ -1,8 +1,10 @@
 #include "AnimationEngine.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include "Animator.h"
+#include "PoseBatch.h"
 #include "Skeleton.h"
 
 
@@ -15,6 +17,21 @@ namespace Animix
 	{
 		assert(!g_AnimixEngine && "Cannot instantiate multiple animation engines!");
 		g_AnimixEngine = this;
+
+		m_FrameArenas.emplace_back(std::make_unique<FrameArena>());
+
+		// Full rate up close, then gradually reduce the update rate
+		SetLODTiers({
+			{ 0.0f, 1, PaletteApproximation::Interpolate },
+			{ 1000.0f, 2, PaletteApproximation::Interpolate },
+			{ 2500.0f, 4, PaletteApproximation::Extrapolate }
+		});
+	}
+
+	AnimationEngine::~AnimationEngine()
+	{
+		// Allow another engine to be created once this one is gone
+		g_AnimixEngine = nullptr;
 	}
 
 	void AnimationEngine::Tick(float deltaTime)
@@ -24,32 +41,212 @@ namespace Animix
 		m_DeltaTime = deltaTime;
 		m_TickIndex++;
 
-		// Update all animators
-		for (auto& animator : m_Animators)
-			animator.UpdatePose();
+		// Everything allocated last tick is no longer in use
+		for (auto& arena : m_FrameArenas)
+			arena->Reset();
+
+		// Which thread updates which animators changes from tick to tick, so every arena must be able to hold what any of them needed
+		for (auto& arena : m_FrameArenas)
+		{
+			for (const auto& other : m_FrameArenas)
+				arena->GrowToMatch(*other);
+		}
+
+		m_Profiler.BeginFrame();
+		{
+			ANIMIX_PROFILE_SCOPE("AnimationEngine::Tick");
+
+			// Update all animators
+			// Engine state must not be modified from here on, as animators may be updated on other threads
+			if (m_JobSystem)
+			{
+				m_JobSystem->ParallelFor(m_Animators.Size(), 1, [this, deltaTime](size_t index)
+					{
+						m_Animators[index].Update(deltaTime, index);
+					});
+			}
+			else
+			{
+				for (size_t index = 0; index < m_Animators.Size(); index++)
+					m_Animators[index].Update(deltaTime, index);
+			}
+
+			BuildDeferredPalettes();
+
+			// All animators have finished; hand the new palettes to the renderer together
+			ANIMIX_PROFILE_SCOPE("AnimationEngine::PublishPalettes");
+			m_SkippedAnimatorCount = 0;
+			for (size_t index = 0; index < m_Animators.Size(); index++)
+			{
+				Animator& animator = m_Animators[index];
+				animator.PublishMatrixPalette();
+				m_SkippedAnimatorCount += animator.WasPoseReused() ? 1 : 0;
+			}
+		}
+		m_Profiler.EndFrame();
+	}
+
+	void AnimationEngine::BuildDeferredPalettes()
+	{
+		ANIMIX_PROFILE_SCOPE("AnimationEngine::BuildDeferredPalettes");
+
+		// Group the animators that deferred their pose by skeleton
+		m_DeferredAnimators.clear();
+		for (size_t index = 0; index < m_Animators.Size(); index++)
+		{
+			if (m_Animators[index].HasDeferredPose())
+				m_DeferredAnimators.push_back(&m_Animators[index]);
+		}
+		std::sort(m_DeferredAnimators.begin(), m_DeferredAnimators.end(), [](const Animator* a, const Animator* b)
+			{
+				return a->GetTarget() < b->GetTarget();
+			});
+
+		// Split each group into batches that fit in SIMD lanes
+		m_PoseBatches.clear();
+		for (size_t begin = 0; begin < m_DeferredAnimators.size(); )
+		{
+			PoseBatch batch;
+			const SkeletonID skeleton = m_DeferredAnimators[begin]->GetTarget();
+			while (batch.Count < POSE_BATCH_WIDTH && begin < m_DeferredAnimators.size() && m_DeferredAnimators[begin]->GetTarget() == skeleton)
+				batch.Animators[batch.Count++] = m_DeferredAnimators[begin++];
+
+			m_PoseBatches.push_back(batch);
+		}
+
+		const auto buildBatch = [this](size_t index)
+		{
+			const PoseBatch& batch = m_PoseBatches[index];
+			const Skeleton& skeleton = m_Skeletons[batch.Animators[0]->GetTarget()];
+
+			const JointTransform* localPoses[POSE_BATCH_WIDTH];
+			gef::Matrix44* palettes[POSE_BATCH_WIDTH];
+			for (size_t lane = 0; lane < batch.Count; lane++)
+			{
+				localPoses[lane] = batch.Animators[lane]->GetDeferredLocalPose();
+				palettes[lane] = batch.Animators[lane]->GetDeferredPalette();
+			}
+
+			// Scratch space is only needed for the duration of this batch
+			FrameArena& arena = GetFrameArena();
+			const FrameArena::Marker marker = arena.GetMarker();
+			void* scratch = arena.Allocate(GetPoseBatchScratchSize(skeleton.Joints.size()), POSE_BATCH_SCRATCH_ALIGNMENT);
+
+			BuildMatrixPalettesBatched(skeleton, localPoses, palettes, batch.Count, scratch);
+			arena.Rewind(marker);
+
+			for (size_t lane = 0; lane < batch.Count; lane++)
+				batch.Animators[lane]->CompleteDeferredPose();
+		};
+
+		if (m_JobSystem)
+		{
+			m_JobSystem->ParallelFor(m_PoseBatches.size(), 1, buildBatch);
+		}
+		else
+		{
+			for (size_t index = 0; index < m_PoseBatches.size(); index++)
+				buildBatch(index);
+		}
+	}
+
+	void AnimationEngine::ForceAllPoseUpdates()
+	{
+		for (size_t index = 0; index < m_Animators.Size(); index++)
+			m_Animators[index].ForcePoseUpdate();
 	}
 
+	void AnimationEngine::SetRotationBlendMode(RotationBlendMode mode)
+	{
+		if (mode == m_RotationBlendMode)
+			return;
+
+		m_RotationBlendMode = mode;
+		ForceAllPoseUpdates();
+	}
+
+	void AnimationEngine::SetCompiledBlendTrees(bool compiled)
+	{
+		if (compiled == m_CompiledBlendTrees)
+			return;
+
+		m_CompiledBlendTrees = compiled;
+		ForceAllPoseUpdates();
+	}
+
+	void AnimationEngine::SetWorkerCount(uint32_t workerCount)
+	{
+		if (workerCount == GetWorkerCount())
+			return;
+
+		// Shuts down any existing workers
+		m_JobSystem.reset();
+		if (workerCount > 0)
+			m_JobSystem = std::make_unique<JobSystem>(workerCount);
+
+		m_FrameArenas.resize(workerCount + 1);
+		for (auto& arena : m_FrameArenas)
+			if (!arena) arena = std::make_unique<FrameArena>();
+		m_Profiler.SetThreadCount(workerCount + 1);
+	}
+
+	void AnimationEngine::SetLODTiers(std::vector<AnimationLODTier>&& tiers)
+	{
+		m_LODTiers = std::move(tiers);
+		std::sort(m_LODTiers.begin(), m_LODTiers.end(), [](const AnimationLODTier& a, const AnimationLODTier& b)
+			{
+				return a.MinDistance < b.MinDistance;
+			});
+	}
+
+	AnimationLODTier AnimationEngine::SelectLODTier(float distance) const
+	{
+		AnimationLODTier tier;
+		for (const auto& candidate : m_LODTiers)
+		{
+			if (distance < candidate.MinDistance)
+				break;
+			tier = candidate;
+		}
+		return tier;
+	}
+
+
 	SkeletonID AnimationEngine::CreateSkeleton(std::vector<Joint>&& joints)
 	{
 		assert(m_SkeletonCount < MAX_SKELETONS - 1);
 		m_Skeletons[m_SkeletonCount].ID = m_SkeletonCount;
 		m_Skeletons[m_SkeletonCount].Joints = std::move(joints);
+
+		auto& invBindPoseAffine = m_Skeletons[m_SkeletonCount].InvBindPoseAffine;
+		invBindPoseAffine.clear();
+		m_Skeletons[m_SkeletonCount].RigidInvBindPose = true;
+		for (const Joint& joint : m_Skeletons[m_SkeletonCount].Joints)
+		{
+			invBindPoseAffine.push_back(AffineTransform::FromMatrix(joint.InvBindPose));
+			m_Skeletons[m_SkeletonCount].RigidInvBindPose &= invBindPoseAffine.back().IsRigid();
+		}
 		
 		return m_SkeletonCount++;
 	}
 
-	Animator* AnimationEngine::CreateAnimator(SkeletonID target)
+	AnimatorHandle AnimationEngine::CreateAnimator(SkeletonID target)
+	{
+		return m_Animators.Create(target);
+	}
+
+	void AnimationEngine::DestroyAnimator(AnimatorHandle handle)
 	{
-		m_Animators.emplace_back(target);
-		return &m_Animators.back();
+		m_Animators.Destroy(handle);
 	}
 
 	AnimationClip* AnimationEngine::CreateAnimationClip(const std::string& animName, SkeletonID target)
 	{
-		assert(m_AnimationClips.find(animName) == m_AnimationClips.end());
+		const NameID id = InternName(animName);
+		assert(m_AnimationClips.find(id) == m_AnimationClips.end());
 
-		m_AnimationClips.insert(std::make_pair(animName, std::make_unique<AnimationClip>(target)));
-		return m_AnimationClips.at(animName).get();
+		m_AnimationClips.insert(std::make_pair(id, std::make_unique<AnimationClip>(target)));
+		return m_AnimationClips.at(id).get();
 	}
 
 }
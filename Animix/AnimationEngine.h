@@ -8,11 +8,20 @@
 #include "Skeleton.h"
 #include "Animator.h"
 #include "AnimationClip.h"
+#include "NameID.h"
+#include "FrameArena.h"
+#include "GenerationalPool.h"
+#include "JobSystem.h"
+#include "PoseBatch.h"
+#include "PoseBlend.h"
+#include "Profiler.h"
 
 namespace Animix
 {
 	extern class AnimationEngine* g_AnimixEngine;
 
+	using AnimatorHandle = Handle<Animator>;
+
 	/**
 	 * The animation engine drives all animation.
 	 * It provides resource management of animation resources,
@@ -24,7 +33,10 @@ namespace Animix
 	{
 	public:
 		AnimationEngine();
+		~AnimationEngine();
 
+		// Matrix palettes are published once all animators have updated
+		// The renderer may acquire and draw the previously published palettes while a tick is in progress
 		void Tick(float deltaTime);
 
 		// Timer
@@ -32,31 +44,101 @@ namespace Animix
 		inline float GetDeltaTime() const { return m_DeltaTime; }
 		inline uint64_t GetTickIndex() const { return m_TickIndex; }
 
+		// Settings
+		inline RotationBlendMode GetRotationBlendMode() const { return m_RotationBlendMode; }
+		// Changing a setting that affects poses makes every animator rebuild its pose on the next tick
+		void SetRotationBlendMode(RotationBlendMode mode);
+		// Build the global poses and palettes of animators that share a skeleton together, several at a time
+		inline bool GetPoseBatching() const { return m_PoseBatching; }
+		inline void SetPoseBatching(bool batching) { m_PoseBatching = batching; }
+		// Evaluate blend trees as flat compiled programs, rather than by walking their nodes
+		inline bool GetCompiledBlendTrees() const { return m_CompiledBlendTrees; }
+		void SetCompiledBlendTrees(bool compiled);
+
+		// Animators are updated across this many worker threads, as well as the thread calling Tick
+		// 0 updates all animators serially on the calling thread
+		void SetWorkerCount(uint32_t workerCount);
+		inline uint32_t GetWorkerCount() const { return m_JobSystem ? m_JobSystem->GetWorkerCount() : 0; }
+
+		// Transient data for the current tick, belonging to the calling thread
+		inline FrameArena& GetFrameArena() const { return *m_FrameArenas[JobSystem::GetCurrentThreadIndex()]; }
+		// One arena per thread that updates animators, for reporting
+		inline size_t GetFrameArenaCount() const { return m_FrameArenas.size(); }
+		inline const FrameArena& GetFrameArena(size_t index) const { return *m_FrameArenas.at(index); }
+
+		// Timings of the animation hot path; disabled until enabled at runtime
+		inline Profiler& GetProfiler() { return m_Profiler; }
+		inline const Profiler& GetProfiler() const { return m_Profiler; }
+
+		// Level of detail
+		// Tiers are sorted by distance; animators use the furthest tier they are beyond
+		void SetLODTiers(std::vector<AnimationLODTier>&& tiers);
+		inline const std::vector<AnimationLODTier>& GetLODTiers() const { return m_LODTiers; }
+		AnimationLODTier SelectLODTier(float distance) const;
+
 		// Resource management
 		const Skeleton* GetSkeleton(SkeletonID id) const { return &m_Skeletons.at(id); }
 
-		const AnimationClip* GetAnimationClip(const std::string& AnimationName) const { return m_AnimationClips.at(AnimationName).get(); }
+		const AnimationClip* GetAnimationClip(NameID animationID) const { return m_AnimationClips.at(animationID).get(); }
+		const AnimationClip* GetAnimationClip(const std::string& AnimationName) const { return GetAnimationClip(HashName(AnimationName)); }
+		bool DoesAnimationClipExist(const std::string& AnimationName) const { return m_AnimationClips.count(HashName(AnimationName)) > 0; }
 
 		// Create assets
 		SkeletonID CreateSkeleton(std::vector<Joint>&& joints);
-		Animator* CreateAnimator(SkeletonID target);
+		// Animators can be created and destroyed at any time other than during Tick
+		// Pointers to an animator remain valid until it is destroyed; handles can also detect that it has been destroyed
+		AnimatorHandle CreateAnimator(SkeletonID target);
+		void DestroyAnimator(AnimatorHandle handle);
+		inline Animator* GetAnimator(AnimatorHandle handle) const { return m_Animators.Get(handle); }
+		inline size_t GetAnimatorCount() const { return m_Animators.Size(); }
+		// Animators that did not need to evaluate their pose last tick, as nothing it depends on had changed
+		inline size_t GetSkippedAnimatorCount() const { return m_SkippedAnimatorCount; }
 
 		AnimationClip* CreateAnimationClip(const std::string& animName, SkeletonID target);
 
+	private:
+		// Build the palettes of animators that deferred their pose, in batches of the same skeleton
+		void BuildDeferredPalettes();
+		// Poses that have not changed reuse their previous palette, which is stale once an engine-wide setting changes
+		void ForceAllPoseUpdates();
+
 	private:
 		// Timing information
 		float m_GlobalTimer = 0.0f;
 		float m_DeltaTime = 0.0f;
 		uint64_t m_TickIndex = 0u;
 
+		RotationBlendMode m_RotationBlendMode = RotationBlendMode::NLerp;
+		bool m_PoseBatching = true;
+		bool m_CompiledBlendTrees = true;
+
+		// Only exists when animators are updated in parallel
+		std::unique_ptr<JobSystem> m_JobSystem;
+		// Indexed by JobSystem thread index
+		std::vector<std::unique_ptr<FrameArena>> m_FrameArenas;
+		Profiler m_Profiler;
+
+		// Animation level of detail
+		std::vector<AnimationLODTier> m_LODTiers;
+
 		// A collection of all skeletons recognized by the engine
 		std::array<Skeleton, MAX_SKELETONS> m_Skeletons;
 		SkeletonID m_SkeletonCount = 0;
 
 		// A collection of all animators present in the game
-		std::vector<Animator> m_Animators;
+		GenerationalPool<Animator> m_Animators;
+		size_t m_SkippedAnimatorCount = 0;
+
+		// Animators whose palettes are built in batches this tick
+		struct PoseBatch
+		{
+			Animator* Animators[POSE_BATCH_WIDTH] = {};
+			size_t Count = 0;
+		};
+		std::vector<Animator*> m_DeferredAnimators;
+		std::vector<PoseBatch> m_PoseBatches;
 
 		// All animation clips
-		std::unordered_map<std::string, std::unique_ptr<AnimationClip>> m_AnimationClips;
+		std::unordered_map<NameID, std::unique_ptr<AnimationClip>> m_AnimationClips;
 	};
 }
@@ -1,5 +1,6 @@
 #include "Animator.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include "AnimationClip.h"
@@ -9,18 +10,71 @@
 
 namespace Animix
 {
+	namespace
+	{
+		constexpr uint32_t PALETTE_INDEX_MASK = 0x3;
+		constexpr uint32_t PALETTE_UNREAD = 0x4;
+	}
+
+
 	Animator::Animator(SkeletonID target)
 		: m_Target(target)
 		, m_BindPose(target)
 	{
 		m_ParameterTable = std::make_unique<ParameterTable>();
 
-		// Set matrix palette to current size
-		const auto sk = g_AnimixEngine->GetSkeleton(m_Target);
-		m_MatrixPalette.resize(sk->Joints.size());
-
 		m_BindPose.BuildBindPose();
-		BuildMatrixPalette(m_BindPose);
+		ResetPalettes();
+	}
+
+	void Animator::ResetPalettes()
+	{
+		// Set the palettes of the current format to the current size, and release the others
+		const size_t jointCount = g_AnimixEngine->GetSkeleton(m_Target)->Joints.size();
+		const size_t matrixCount = m_PaletteFormat == PaletteFormat::Matrix ? jointCount : 0;
+		const size_t qtCount = m_PaletteFormat == PaletteFormat::QuaternionTranslation ? jointCount : 0;
+
+		GetWritePalette().resize(matrixCount);
+		m_PreviousPalette.resize(matrixCount);
+		m_LatestPalette.resize(matrixCount);
+		GetWriteQTPalette().resize(qtCount);
+		m_PreviousQTPalette.resize(qtCount);
+		m_LatestQTPalette.resize(qtCount);
+		m_DeferredLocalPoseStorage.resize(matrixCount);
+		m_PaletteHistory = 0;
+
+		if (m_PaletteFormat == PaletteFormat::QuaternionTranslation)
+			BuildQTPaletteFromPose(nullptr);
+		else
+			BuildMatrixPalette(m_BindPose);
+
+		// Everything starts in the bind pose
+		for (auto& palette : m_Palettes)
+		{
+			palette = GetWritePalette();
+			palette.shrink_to_fit();
+		}
+		for (auto& palette : m_QTPalettes)
+		{
+			palette = GetWriteQTPalette();
+			palette.shrink_to_fit();
+		}
+		m_PaletteWritten = false;
+	}
+
+	bool Animator::SetPaletteFormat(PaletteFormat format)
+	{
+		if (format == m_PaletteFormat)
+			return true;
+
+		// Scale in the inverse bind pose would be lost
+		if (format == PaletteFormat::QuaternionTranslation && !g_AnimixEngine->GetSkeleton(m_Target)->RigidInvBindPose)
+			return false;
+
+		m_PaletteFormat = format;
+		ResetPalettes();
+		m_ForcePoseUpdate = true;
+		return true;
 	}
 
 	void Animator::Clear()
@@ -32,13 +86,14 @@ namespace Animix
 		m_NextState = nullptr;
 
 		m_ParameterTable->Clear();
+		m_ForcePoseUpdate = true;
 	}
 
 	bool Animator::LoadFromJSON(const std::string& filename)
 	{
-		std::string prevState;
+		NameID prevState = 0;
 		if (m_CurrentState)
-			prevState = m_CurrentState->GetName();
+			prevState = HashName(m_CurrentState->GetName());
 
 		Clear();
 
@@ -54,29 +109,158 @@ namespace Animix
 		return success;
 	}
 
-	void Animator::UpdatePose()
+	void Animator::Update(float deltaTime, size_t staggerIndex)
+	{
+		m_PoseReused = false;
+		m_PendingDeltaTime += deltaTime;
+
+		const uint32_t interval = std::max(m_LODTier.UpdateInterval, 1u);
+		const bool updateThisFrame = (g_AnimixEngine->GetTickIndex() + staggerIndex) % interval == 0
+			|| m_FramesSinceUpdate + 1 >= interval;		// in case the interval has just changed
+
+		if (updateThisFrame)
+		{
+			ANIMIX_PROFILE_SCOPE_DETAIL("Animator::UpdatePose", m_CurrentState ? m_CurrentState->GetID() : 0, static_cast<uint32_t>(staggerIndex));
+			UpdatePose(m_PendingDeltaTime);
+			m_PendingDeltaTime = 0.0f;
+			m_FramesSinceUpdate = 0;
+		}
+		else
+		{
+			m_FramesSinceUpdate++;
+		}
+
+		// Deferred poses are approximated once their palette has been built
+		if (interval > 1 && !m_DeferredLocalPose)
+			ApproximateMatrixPalette();
+	}
+
+	void Animator::PublishMatrixPalette()
+	{
+		if (!m_PaletteWritten)
+			// Keep the previously published palette; the write palette may be out of date
+			return;
+
+		// Swap the write palette with the published one
+		const uint32_t previous = m_PublishedPalette.exchange(m_WritePalette | PALETTE_UNREAD, std::memory_order_acq_rel);
+		m_WritePalette = previous & PALETTE_INDEX_MASK;
+		m_PaletteWritten = false;
+	}
+
+	const std::vector<gef::Matrix44>& Animator::AcquireMatrixPalette()
+	{
+		assert(m_PaletteFormat == PaletteFormat::Matrix);
+		return m_Palettes[AcquirePalette()];
+	}
+
+	const std::vector<QTTransform>& Animator::AcquireQTPalette()
+	{
+		assert(m_PaletteFormat == PaletteFormat::QuaternionTranslation);
+		return m_QTPalettes[AcquirePalette()];
+	}
+
+	uint32_t Animator::AcquirePalette()
+	{
+		if (m_PublishedPalette.load(std::memory_order_relaxed) & PALETTE_UNREAD)
+		{
+			// Swap the read palette with the newly published one
+			const uint32_t published = m_PublishedPalette.exchange(m_ReadPalette, std::memory_order_acq_rel);
+			m_ReadPalette = published & PALETTE_INDEX_MASK;
+		}
+
+		return m_ReadPalette;
+	}
+
+	void Animator::SetLODDistance(float distance)
 	{
+		m_LODTier = g_AnimixEngine->SelectLODTier(distance);
+	}
+
+	void Animator::UpdatePose(float deltaTime)
+	{
+		m_PoseReused = false;
+
 		if (m_States.empty() || !m_CurrentState)
 			// Nothing to animate
 			return;
 
-		SkeletonPose blendedPose{ m_BindPose };
-
 		// Frozen transitions should not progress time in the current state
 		const float freezeTime = m_NextState && m_TransitionType == TransitionType::Frozen ? 0.0f : 1.0f;
 
-		bool blendsValid = m_CurrentState->GetBlendTree()->TickAndEvaluateTree(blendedPose, freezeTime);
+		// Advancing time is cheap, but evaluating the pose is not, so only evaluate if the pose could have changed
+		const bool inTransition = m_NextState != nullptr;
+		const bool currentValid = m_CurrentState->GetBlendTree()->Tick(deltaTime, freezeTime);
+		const bool nextValid = inTransition && m_NextState->GetBlendTree()->Tick(deltaTime);
+
+		if (HasPoseChanged())
+		{
+			EvaluatePose(currentValid, nextValid);
+		}
+		else
+		{
+			m_PoseReused = true;
+			ReuseMatrixPalette();
+		}
+
+		if (!inTransition && m_CurrentState->HasEndTransition())
+		{
+			// Check for end of state transition
+			const float remainingDuration = m_CurrentState->GetBlendTree()->CalculateRemainingDuration();
+
+			const NameID endTransition = m_CurrentState->GetEndTransition();
+			const float transitionDuration = m_TransitionType == TransitionType::Frozen ? 0.0f : m_CurrentState->GetTransition(endTransition).Duration;
+
+			if (remainingDuration <= transitionDuration)
+			{
+				// Transition to the next state if it has one
+				Transition(endTransition);
+			}
+		}
+	}
+
+	bool Animator::HasPoseChanged() const
+	{
+		// The ragdoll may be moving, and transitions blend over time
+		if (m_ForcePoseUpdate || m_Ragdoll || m_NextState)
+			return true;
+
+		// Node variables are driven by parameters
+		if (m_CurrentState != m_EvaluatedState || m_ParameterTable->GetVersion() != m_EvaluatedParameterVersion)
+			return true;
+
+		// Clips that are still playing
+		return m_CurrentState->GetBlendTree()->HasChanged();
+	}
+
+	void Animator::EvaluatePose(bool currentValid, bool nextValid)
+	{
+		// Poses only live for this update, so come from the frame arena
+		PosePool& posePool = g_AnimixEngine->GetFrameArena().GetPosePool();
+
+		// Start from the bind pose, in case the blend tree is not valid
+		const ScopedPose scopedPose(posePool, m_Target);
+		SkeletonPose& blendedPose = scopedPose.Get();
+		blendedPose = m_BindPose;
+
+		if (currentValid)
+			m_CurrentState->GetBlendTree()->Evaluate(blendedPose);
+		bool blendsValid = currentValid;
 
 		// also handle transitions
 		if (m_NextState)
 		{
-			SkeletonPose nextBlendedPose{ m_Target };
-			blendsValid &= m_NextState->GetBlendTree()->TickAndEvaluateTree(nextBlendedPose);
+			const ScopedPose scopedNextPose(posePool, m_Target);
+			SkeletonPose& nextBlendedPose = scopedNextPose.Get();
+			if (nextValid)
+				m_NextState->GetBlendTree()->Evaluate(nextBlendedPose);
+			else
+				nextBlendedPose = m_BindPose;
+			blendsValid &= nextValid;
 
 			// Calculate progress through the transition
 			const float t = (g_AnimixEngine->GetGlobalTime() - m_NextState->GetBlendTree()->GetStartTime()) / m_TransitionDuration;
 
-			blendedPose = SkeletonPose::Lerp(blendedPose, nextBlendedPose, t);
+			SkeletonPose::Lerp(blendedPose, nextBlendedPose, t, blendedPose);
 
 			// is transition complete?
 			if (t >= 1.0f)
@@ -85,24 +269,24 @@ namespace Animix
 				m_NextState = nullptr;
 			}
 		}
-		else if (m_CurrentState->HasEndTransition())
-		{
-			// Check for end of state transition
-			const float remainingDuration = m_CurrentState->GetBlendTree()->CalculateRemainingDuration();
 
-			const std::string& endTransition = m_CurrentState->GetEndTransition();
-			const float transitionDuration = m_TransitionType == TransitionType::Frozen ? 0.0f : m_CurrentState->GetTransition(endTransition).Duration;
+		// Remember what this pose was built from, so that it can be reused if none of it changes
+		m_ForcePoseUpdate = false;
+		m_EvaluatedState = m_CurrentState;
+		m_EvaluatedParameterVersion = m_ParameterTable->GetVersion();
 
-			if (remainingDuration <= transitionDuration)
+		if (blendsValid)
+		{
+			if (!m_Ragdoll && m_PaletteFormat == PaletteFormat::Matrix && g_AnimixEngine->GetPoseBatching())
 			{
-				// Transition to the next state if it has one
-				Transition(endTransition);
+				// The engine builds the global pose and palette later, together with other animators that share the skeleton
+				// The local pose must outlive the scoped pose, so is kept by the animator rather than in the frame arena,
+				// whose use would otherwise depend on how many animators each thread happened to update
+				std::copy(blendedPose.LocalPose.begin(), blendedPose.LocalPose.end(), m_DeferredLocalPoseStorage.begin());
+				m_DeferredLocalPose = m_DeferredLocalPoseStorage.data();
+				return;
 			}
-		}
 
-		
-		if (blendsValid)
-		{
 			blendedPose.BuildGlobalPose();
 		}
 
@@ -122,38 +306,144 @@ namespace Animix
 		
 		// If blend tree was not valid, blendedPose will still contain bind pose
 		// Therefore do not need to re-calculate the global pose prior to constructing matrix palette
-		BuildMatrixPalette(blendedPose);
+		if (m_PaletteFormat == PaletteFormat::QuaternionTranslation)
+			BuildQTPaletteFromPose(blendsValid ? &blendedPose : nullptr);
+		else
+			BuildMatrixPalette(blendedPose);
+	}
+
+	void Animator::ReuseMatrixPalette()
+	{
+		// The published palette may be approximated from the last two updates at a reduced update rate
+		// Settle on the latest palette, after which there is nothing more to publish until the pose changes
+		if (m_PaletteHistory == 2)
+		{
+			if (m_PaletteFormat == PaletteFormat::QuaternionTranslation)
+				GetWriteQTPalette() = m_LatestQTPalette;
+			else
+				GetWritePalette() = m_LatestPalette;
+			m_PaletteWritten = true;
+			m_PaletteHistory = 1;
+		}
 	}
 
 	void Animator::BuildMatrixPalette(const SkeletonPose& globalPose)
 	{
 		const auto skeleton = g_AnimixEngine->GetSkeleton(m_Target);
-		const auto& joints = skeleton->Joints;
+		const auto& invBindPose = skeleton->InvBindPoseAffine;
 
+		// The renderer takes full matrices
+		std::vector<gef::Matrix44>& palette = GetWritePalette();
 		for (size_t joint = 0; joint < skeleton->Joints.size(); joint++)
 		{
-			m_MatrixPalette[joint] = joints[joint].InvBindPose * globalPose.GlobalPose[joint];
+			(invBindPose[joint] * globalPose.GlobalPose[joint]).ToMatrix(palette[joint]);
+		}
+
+		RecordMatrixPalette();
+	}
+
+	void Animator::BuildQTPaletteFromPose(const SkeletonPose* globalPose)
+	{
+		std::vector<QTTransform>& palette = GetWriteQTPalette();
+		if (globalPose)
+			BuildQTPalette(*g_AnimixEngine->GetSkeleton(m_Target), globalPose->GlobalPose.data(), palette.data());
+		else
+			// Every joint is where its inverse bind pose expects it
+			std::fill(palette.begin(), palette.end(), QTTransform());
+
+		RecordMatrixPalette();
+	}
+
+	void Animator::RecordMatrixPalette()
+	{
+		m_PaletteWritten = true;
+
+		// Remember the palette, so that it can be approximated on frames that the pose is not updated
+		if (m_PaletteFormat == PaletteFormat::QuaternionTranslation)
+		{
+			std::swap(m_PreviousQTPalette, m_LatestQTPalette);
+			m_LatestQTPalette = GetWriteQTPalette();
+		}
+		else
+		{
+			std::swap(m_PreviousPalette, m_LatestPalette);
+			m_LatestPalette = GetWritePalette();
+		}
+		m_PaletteHistory = std::min(m_PaletteHistory + 1, 2u);
+	}
+
+	void Animator::CompleteDeferredPose()
+	{
+		assert(m_DeferredLocalPose);
+		m_DeferredLocalPose = nullptr;
+
+		RecordMatrixPalette();
+		if (m_LODTier.UpdateInterval > 1)
+			ApproximateMatrixPalette();
+	}
+
+	void Animator::ApproximateMatrixPalette()
+	{
+		if (m_PaletteHistory < 2)
+		{
+			// Nothing to blend with; hold the latest palette
+			return;
+		}
+
+		// Progress through the current update interval
+		const float progress = static_cast<float>(m_FramesSinceUpdate) / static_cast<float>(m_LODTier.UpdateInterval);
+		const float t = m_LODTier.Approximation == PaletteApproximation::Interpolate ? progress : 1.0f + progress;
+
+		m_PaletteWritten = true;
+
+		if (m_PaletteFormat == PaletteFormat::QuaternionTranslation)
+		{
+			std::vector<QTTransform>& palette = GetWriteQTPalette();
+			for (size_t joint = 0; joint < palette.size(); joint++)
+				palette[joint] = LerpQT(m_PreviousQTPalette[joint], m_LatestQTPalette[joint], t);
+			return;
+		}
+
+		// Blending matrices component-wise does not preserve rotations exactly, but the change between two updates is small
+		std::vector<gef::Matrix44>& palette = GetWritePalette();
+		for (size_t joint = 0; joint < palette.size(); joint++)
+		{
+			const gef::Matrix44& a = m_PreviousPalette[joint];
+			const gef::Matrix44& b = m_LatestPalette[joint];
+			gef::Matrix44& out = palette[joint];
+
+			for (int row = 0; row < 4; row++)
+			{
+				const gef::Vector4 ra = a.GetRow(row);
+				const gef::Vector4 rb = b.GetRow(row);
+				out.SetRow(row, gef::Vector4(
+					ra.x() + (rb.x() - ra.x()) * t,
+					ra.y() + (rb.y() - ra.y()) * t,
+					ra.z() + (rb.z() - ra.z()) * t,
+					ra.w() + (rb.w() - ra.w()) * t));
+			}
 		}
 	}
 
 	AnimatorState* Animator::CreateState(const std::string& name)
 	{
-		if (m_States.find(name) == m_States.end())
-			m_States.emplace(name, std::make_unique<AnimatorState>(this, name));
+		const NameID id = InternName(name);
+		if (m_States.find(id) == m_States.end())
+			m_States.emplace(id, std::make_unique<AnimatorState>(this, name));
 
 		if (!m_CurrentState)
-			m_CurrentState = m_States.at(name).get();
+			m_CurrentState = m_States.at(id).get();
 
-		return m_States.at(name).get();
+		return m_States.at(id).get();
 	}
 
-	AnimatorState* Animator::GetState(const std::string& name) const
+	AnimatorState* Animator::GetState(NameID id) const
 	{
-		assert(m_States.find(name) != m_States.end());
-		return m_States.at(name).get();
+		assert(m_States.find(id) != m_States.end());
+		return m_States.at(id).get();
 	}
 
-	bool Animator::Transition(const std::string& transitionName)
+	bool Animator::Transition(NameID transitionID)
 	{
 		// Check if a transition is already in progress
 		if (m_NextState)
@@ -162,19 +452,19 @@ namespace Animix
 		if (m_CurrentState)
 		{
 			// Check if this is a defined transition
-			if (m_CurrentState->HasTransition(transitionName))
-				return BeginTransitionInternal(transitionName);
+			if (m_CurrentState->HasTransition(transitionID))
+				return BeginTransitionInternal(transitionID);
 		}
 
 		return false;
 	}
 
-	bool Animator::BeginTransitionInternal(const std::string& transitionName)
+	bool Animator::BeginTransitionInternal(NameID transitionID)
 	{
-		const StateTransition& transition = m_CurrentState->GetTransition(transitionName);
+		const StateTransition& transition = m_CurrentState->GetTransition(transitionID);
 
 		// Check the destination state exists
-		if (m_States.find(transition.DestinationState) == m_States.end())
+		if (m_States.find(transition.DestinationStateID) == m_States.end())
 			return false;
 
 		// The action to take depends on the transition type
@@ -182,7 +472,7 @@ namespace Animix
 		{
 		case TransitionType::Immediate:
 			{
-				m_CurrentState = m_States.at(transition.DestinationState).get();
+				m_CurrentState = m_States.at(transition.DestinationStateID).get();
 				// Call begin on the blend tree to get it ready to play its animation
 				m_CurrentState->GetBlendTree()->Start();
 
@@ -190,7 +480,7 @@ namespace Animix
 			}
 		case TransitionType::Smooth:
 			{
-				m_NextState = m_States.at(transition.DestinationState).get();
+				m_NextState = m_States.at(transition.DestinationStateID).get();
 				m_TransitionDuration = transition.Duration;
 				// Call begin on the blend tree to get it ready to play its animation
 				m_NextState->GetBlendTree()->Start();
@@ -199,7 +489,7 @@ namespace Animix
 			}
 		case TransitionType::Frozen:
 			{
-				m_NextState = m_States.at(transition.DestinationState).get();
+				m_NextState = m_States.at(transition.DestinationStateID).get();
 				m_TransitionDuration = transition.Duration;
 				// Call begin on the blend tree to get it ready to play its animation
 				m_NextState->GetBlendTree()->Start();
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <vector>
 
+#include "QTPalette.h"
 #include "StateMachine.h"
 #include "Blending/ParameterTable.h"
 
@@ -14,6 +17,26 @@ namespace Animix
 	// Forward declarations
 	class SkeletalMeshInstance;
 
+	// How an animator's matrix palette is produced on frames where its pose is not updated
+	enum class PaletteApproximation : uint8_t
+	{
+		// Blend between the two most recent palettes; smooth, but shows the pose one update late
+		Interpolate,
+		// Continue the motion between the two most recent palettes; no delay, but can overshoot
+		Extrapolate
+	};
+
+	/**
+	 * An animation level of detail.
+	 * Animators further than MinDistance from the viewer update their pose every UpdateInterval frames
+	 */
+	struct AnimationLODTier
+	{
+		float MinDistance = 0.0f;
+		uint32_t UpdateInterval = 1;
+		PaletteApproximation Approximation = PaletteApproximation::Interpolate;
+	};
+
 	/**
 	 * The animator combines a blend tree, a property table, and a skeletal mesh instance
 	 */
@@ -27,18 +50,57 @@ namespace Animix
 		// Load state machine data from a JSON file
 		bool LoadFromJSON(const std::string& filename);
 
-		inline const std::vector<gef::Matrix44>& GetMatrixPalette() const { return m_MatrixPalette; }
+		// The palette is triple buffered, so that it can be rendered while the next tick is being computed
+		// Called by the renderer: takes the most recently published palette, which will not change until the next call
+		const std::vector<gef::Matrix44>& AcquireMatrixPalette();
+		// The palette taken by the last call to AcquireMatrixPalette
+		inline const std::vector<gef::Matrix44>& GetMatrixPalette() const { return m_Palettes[m_ReadPalette]; }
+		// The equivalents for the quaternion-translation palette format
+		const std::vector<QTTransform>& AcquireQTPalette();
+		inline const std::vector<QTTransform>& GetQTPalette() const { return m_QTPalettes[m_ReadPalette]; }
+
+		// Only the palette of the chosen format is written; it restarts from the bind pose when changed
+		// Must not be changed during Tick, or while the renderer is drawing an acquired palette
+		// Returns false, keeping the current format, if the skeleton's inverse bind pose cannot be held by the format
+		bool SetPaletteFormat(PaletteFormat format);
+		inline PaletteFormat GetPaletteFormat() const { return m_PaletteFormat; }
 		inline const SkeletonPose& GetBindPose() const { return m_BindPose; }
 
 		// Called by animation engine
-		void UpdatePose();
+		// Animators only modify their own state while updating, so different animators may be updated concurrently
+		// The stagger index spreads animators with the same reduced update rate evenly across frames
+		void Update(float deltaTime, size_t staggerIndex);
+		void UpdatePose(float deltaTime);
+		// Did the last call to UpdatePose find that nothing affecting the pose had changed, and reuse the previous palette
+		inline bool WasPoseReused() const { return m_PoseReused; }
+		// Rebuild the pose on the next update even if nothing the animator tracks has changed
+		inline void ForcePoseUpdate() { m_ForcePoseUpdate = true; }
+		// Make the palette written during this tick available to the renderer
+		void PublishMatrixPalette();
+
+		// An animator may leave building its global pose and palette to the engine, so that it can be batched with others of the same skeleton
+		// The engine writes the palette of a deferred pose, then completes it
+		inline bool HasDeferredPose() const { return m_DeferredLocalPose != nullptr; }
+		inline const JointTransform* GetDeferredLocalPose() const { return m_DeferredLocalPose; }
+		inline gef::Matrix44* GetDeferredPalette() { return GetWritePalette().data(); }
+		void CompleteDeferredPose();
+
+		inline SkeletonID GetTarget() const { return m_Target; }
+
+		// Level of detail
+		// The distance (or any other measure of importance, consistent with the engine's LOD tiers) chooses how often the pose is updated
+		void SetLODDistance(float distance);
+		inline void SetLODTier(const AnimationLODTier& tier) { m_LODTier = tier; }
+		inline const AnimationLODTier& GetLODTier() const { return m_LODTier; }
 
 		// State machine API
 		AnimatorState* CreateState(const std::string& name);
-		AnimatorState* GetState(const std::string& name) const;
+		AnimatorState* GetState(NameID id) const;
+		inline AnimatorState* GetState(const std::string& name) const { return GetState(HashName(name)); }
 
 		// Manipulate animation state
-		bool Transition(const std::string& transitionName);
+		bool Transition(NameID transitionID);
+		inline bool Transition(const std::string& transitionName) { return Transition(HashName(transitionName)); }
 
 		// Parameter table
 		ParameterTable* GetParameterTable() const { return m_ParameterTable.get(); }
@@ -49,17 +111,62 @@ namespace Animix
 		AniPhysix::Ragdoll* GetRagdoll() const { return m_Ragdoll.get(); }
 
 	private:
+		inline std::vector<gef::Matrix44>& GetWritePalette() { return m_Palettes[m_WritePalette]; }
+		inline std::vector<QTTransform>& GetWriteQTPalette() { return m_QTPalettes[m_WritePalette]; }
+		// Takes the most recently published palette if there is one, returning the read palette index
+		uint32_t AcquirePalette();
+		// Fill all palettes of the current format with the bind pose
+		void ResetPalettes();
+
+		bool HasPoseChanged() const;
+		void EvaluatePose(bool currentValid, bool nextValid);
+		void ReuseMatrixPalette();
+
 		void BuildMatrixPalette(const SkeletonPose& globalPose);
+		// nullptr builds the bind pose palette
+		void BuildQTPaletteFromPose(const SkeletonPose* globalPose);
+		void RecordMatrixPalette();
+		void ApproximateMatrixPalette();
 
-		bool BeginTransitionInternal(const std::string& transitionName);
+		bool BeginTransitionInternal(NameID transitionID);
 
 	private:
 		SkeletonID m_Target = MAX_SKELETONS;
 		SkeletonPose m_BindPose;
-		std::vector<gef::Matrix44> m_MatrixPalette;
+
+		// Palettes are written by the tick, and read by the renderer
+		// The third is the most recently published palette, which neither is using
+		std::array<std::vector<gef::Matrix44>, 3> m_Palettes;
+		std::array<std::vector<QTTransform>, 3> m_QTPalettes;	// Used instead in the QuaternionTranslation format, with the same indices
+		PaletteFormat m_PaletteFormat = PaletteFormat::Matrix;
+		uint32_t m_WritePalette = 0;
+		uint32_t m_ReadPalette = 1;
+		std::atomic<uint32_t> m_PublishedPalette{ 2 };	// Index, plus PALETTE_UNREAD if it has not been acquired yet
+		bool m_PaletteWritten = false;					// Has the write palette changed since the last publish
+
+		// Level of detail
+		AnimationLODTier m_LODTier;
+		float m_PendingDeltaTime = 0.0f;		// Time that has passed since the pose was last updated
+		uint32_t m_FramesSinceUpdate = 0;
+		// The palettes from the two most recent pose updates, to approximate palettes between updates
+		std::vector<gef::Matrix44> m_PreviousPalette;
+		std::vector<gef::Matrix44> m_LatestPalette;
+		std::vector<QTTransform> m_PreviousQTPalette;
+		std::vector<QTTransform> m_LatestQTPalette;
+		uint32_t m_PaletteHistory = 0;			// How many of the palettes above are valid
+
+		// What the latest palette was evaluated from
+		bool m_ForcePoseUpdate = true;
+		const AnimatorState* m_EvaluatedState = nullptr;
+		uint64_t m_EvaluatedParameterVersion = 0;
+		bool m_PoseReused = false;
+
+		// The local pose evaluated this tick, if the engine is to build its palette
+		const JointTransform* m_DeferredLocalPose = nullptr;
+		std::vector<JointTransform> m_DeferredLocalPoseStorage;
 
 		// State machine
-		std::unordered_map<std::string, std::unique_ptr<AnimatorState>> m_States;
+		std::unordered_map<NameID, std::unique_ptr<AnimatorState>> m_States;
 
 		AnimatorState* m_CurrentState = nullptr;
 
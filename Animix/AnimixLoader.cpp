@@ -1,6 +1,7 @@
 #include "AnimixLoader.h"
 
 #include "AnimationEngine.h"
+#include "KeyReduction.h"
 #include "Skeleton.h"
 
 // gef Includes
@@ -10,14 +11,19 @@
 #include "system/file.h"
 #include "system/memory_stream_buffer.h"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 
 #include "Animator.h"
+#include "Blending/AdditiveBlendNode.h"
 #include "Blending/BilinearBlendNode.h"
+#include "Blending/BlendSpace2DNode.h"
 #include "Blending/BlendTree.h"
 #include "Blending/BlendNode.h"
 #include "Blending/ClipSampleNode.h"
 #include "Blending/GeneralLinearBlendNode.h"
+#include "Blending/LayerBlendNode.h"
 #include "Blending/LinearBlendNode.h"
 #include "Blending/RagdollNode.h"
 
@@ -66,7 +72,8 @@ namespace Animix
 		return skeletonsCreated;
 	}
 
-	bool AnimixLoader::LoadAndNameAnimationFromScene(const std::string& filename, SkeletonID target, const std::string& animName)
+	bool AnimixLoader::LoadAndNameAnimationFromScene(const std::string& filename, SkeletonID target, const std::string& animName,
+		const ClipImportSettings& settings, ClipImportReport* outReport)
 	{
 		// Read file into gef stream
 		const auto scene = std::make_unique<gef::Scene>();
@@ -76,6 +83,10 @@ namespace Animix
 		if (scene->animations.empty())
 			return false;
 
+		// Check the additive reference up front, so a clip that cannot be made additive is never registered
+		if (settings.MakeAdditive && !IsValidAdditiveReference(settings, target))
+			return false;
+
 		const auto skeleton = g_AnimixEngine->GetSkeleton(target);
 
 		// To assist with constructing the animation, a map of joint names to indices is constructed
@@ -89,34 +100,93 @@ namespace Animix
 
 		animClip->SetDuration(gefAnim->duration());
 
-		// Populate animation with animation data
+		// Gather the keys of each track from the gef animation
+		std::vector<std::vector<PositionKey>> positionKeys(skeleton->Joints.size());
+		std::vector<std::vector<RotationKey>> rotationKeys(skeleton->Joints.size());
 		for (const auto& gefJoint : gefAnim->anim_nodes())
 		{
+			// joint node type should be transform
+			if (gefJoint.second->type() != gef::AnimNode::kTransform)
+				continue;
+
 			// get joint name and index
 			const size_t jointIndex = jointIndices.at(gefJoint.first);
+			const auto transformNode = dynamic_cast<gef::TransformAnimNode*>(gefJoint.second);
 
-			// Get all joint samples from the animation
-			JointSamples jointSamples;
-			// joint node type should be transform
-			if (gefJoint.second->type() == gef::AnimNode::kTransform)
+			// Construct position keys
+			for (const auto& key : transformNode->translation_keys())
 			{
-				// Construct position keys
-				for (const auto& key : dynamic_cast<gef::TransformAnimNode*>(gefJoint.second)->translation_keys())
-				{
-					jointSamples.PositionKeys.emplace_back(PositionKey{ key.time, key.value.x(), key.value.y(), key.value.z() });
-				}
+				positionKeys[jointIndex].emplace_back(PositionKey{ key.time, key.value.x(), key.value.y(), key.value.z() });
+			}
 
-				// Construct rotation keys
-				for (const auto& key : dynamic_cast<gef::TransformAnimNode*>(gefJoint.second)->rotation_keys())
-				{
-					jointSamples.RotationKeys.emplace_back(RotationKey{ key.time, key.value });
-				}
+			// Construct rotation keys
+			for (const auto& key : transformNode->rotation_keys())
+			{
+				rotationKeys[jointIndex].emplace_back(RotationKey{ key.time, key.value });
+			}
+		}
+
+		ClipImportReport report;
+
+		// Optionally remove any keys that can be recreated by interpolating their neighbours
+		for (size_t jointIndex = 0; jointIndex < skeleton->Joints.size(); jointIndex++)
+		{
+			report.KeysBeforeReduction += static_cast<uint32_t>(positionKeys[jointIndex].size() + rotationKeys[jointIndex].size());
+
+			if (settings.ReduceKeys)
+			{
+				report.KeysRemoved += ReducePositionKeys(positionKeys[jointIndex], settings.PositionTolerance);
+				report.KeysRemoved += ReduceRotationKeys(rotationKeys[jointIndex], settings.RotationTolerance);
 			}
+		}
 
-			// Move joint samples into the animation object
-			animClip->SetJointSamples(jointIndex, std::move(jointSamples));
+		// Count the keys in each track, so that the clip can allocate all of its key data at once
+		std::vector<uint32_t> positionKeyCounts(skeleton->Joints.size(), 0);
+		std::vector<uint32_t> rotationKeyCounts(skeleton->Joints.size(), 0);
+		for (size_t jointIndex = 0; jointIndex < skeleton->Joints.size(); jointIndex++)
+		{
+			positionKeyCounts[jointIndex] = static_cast<uint32_t>(positionKeys[jointIndex].size());
+			rotationKeyCounts[jointIndex] = static_cast<uint32_t>(rotationKeys[jointIndex].size());
 		}
 
+		animClip->AllocateTracks(positionKeyCounts, rotationKeyCounts);
+
+		// Populate animation with animation data
+		for (size_t jointIndex = 0; jointIndex < skeleton->Joints.size(); jointIndex++)
+		{
+			for (size_t keyIndex = 0; keyIndex < positionKeys[jointIndex].size(); keyIndex++)
+			{
+				const PositionKey& key = positionKeys[jointIndex][keyIndex];
+				animClip->SetPositionKey(jointIndex, keyIndex, key.StartTime, key.Value);
+			}
+
+			for (size_t keyIndex = 0; keyIndex < rotationKeys[jointIndex].size(); keyIndex++)
+			{
+				const RotationKey& key = rotationKeys[jointIndex][keyIndex];
+				animClip->SetRotationKey(jointIndex, keyIndex, key.StartTime, key.Value);
+			}
+		}
+
+		// Subtract the reference before anything else works on the keys, since constant tracks only appear once the reference is removed
+		if (settings.MakeAdditive)
+		{
+			SkeletonPose referencePose(target);
+			BuildAdditiveReferencePose(settings, *animClip, referencePose);
+			animClip->MakeAdditive(referencePose);
+		}
+
+		// Joints that do not move should not cost anything to sample
+		animClip->ExtractConstantTracks();
+
+		if (settings.SampleRate > 0.0f)
+			animClip->Resample(settings.SampleRate);
+
+		if (settings.Compress)
+			animClip->Compress(settings.Compression, &report.Compression);
+
+		if (outReport)
+			*outReport = report;
+
 		return true;
 	}
 
@@ -124,6 +194,35 @@ namespace Animix
 	
 
 
+	bool AnimixLoader::IsValidAdditiveReference(const ClipImportSettings& settings, SkeletonID target)
+	{
+		// The bind pose and the clip's own frames always exist
+		if (settings.Reference == AdditiveReference::BindPose || settings.ReferenceClip.empty())
+			return true;
+
+		if (!g_AnimixEngine->DoesAnimationClipExist(settings.ReferenceClip))
+			return false;
+
+		// The reference must be a whole pose of the same skeleton
+		const AnimationClip* referenceClip = g_AnimixEngine->GetAnimationClip(settings.ReferenceClip);
+		return referenceClip->GetTarget() == target && !referenceClip->IsAdditive();
+	}
+
+
+	void AnimixLoader::BuildAdditiveReferencePose(const ClipImportSettings& settings, const AnimationClip& clip, SkeletonPose& outPose)
+	{
+		if (settings.Reference == AdditiveReference::BindPose)
+		{
+			outPose.BuildBindPose();
+			outPose.RecoverLocalPoseFromGlobal();
+			return;
+		}
+
+		const AnimationClip* referenceClip = settings.ReferenceClip.empty() ? &clip : g_AnimixEngine->GetAnimationClip(settings.ReferenceClip);
+		referenceClip->BuildLocalPose(settings.ReferenceTime, outPose);
+	}
+
+
 	bool AnimixLoader::LoadAnimatorFromJSON(Animator& animator, const std::string& filename)
 	{
 		rapidjson::Document DocJSON;
@@ -261,6 +360,8 @@ namespace Animix
 	bool AnimixLoader::LoadBlendNodeFromJSON(class Animator& animator, BlendTree* blendTree, size_t& outNodeIndex, const rapidjson::Value& json)
 	{
 		BlendNode* blendNode = nullptr;
+		// Blend spaces can only be triangulated once all of their inputs are known
+		BlendSpace2DNode* blendSpaceNode = nullptr;
 
 		CHECK_MEMBER_REQUIRED(json, "type")
 		if (json["type"] == "clipSample")
@@ -321,6 +422,65 @@ namespace Animix
 
 			blendNode = bilinearBlendNode;
 		}
+		else if (json["type"] == "blendSpace2D")
+		{
+			blendSpaceNode = blendTree->CreateNode<BlendSpace2DNode>();
+
+			if (json.HasMember("x") && json.HasMember("y"))
+				blendSpaceNode->SetPosition(json["x"].GetFloat(), json["y"].GetFloat());
+			if (json.HasMember("scaleClips"))
+				blendSpaceNode->SetScaleClips(json["scaleClips"].GetBool());
+			// Every input must be placed in the blend space
+			CHECK_MEMBER_REQUIRED(json, "inputPosition")
+			for (const auto& inputPositionJSON : json["inputPosition"].GetArray())
+			{
+				CHECK_MEMBER_REQUIRED(inputPositionJSON, "input")
+				CHECK_MEMBER_REQUIRED(inputPositionJSON, "x")
+				CHECK_MEMBER_REQUIRED(inputPositionJSON, "y")
+				blendSpaceNode->SetPositionForInput(inputPositionJSON["input"].GetInt(),
+					inputPositionJSON["x"].GetFloat(), inputPositionJSON["y"].GetFloat());
+			}
+
+			blendNode = blendSpaceNode;
+		}
+		else if (json["type"] == "additive")
+		{
+			// Input 0 is the base pose, and input 1 the additive pose
+			const auto additiveBlendNode = blendTree->CreateNode<AdditiveBlendNode>();
+
+			if (json.HasMember("weight"))
+				additiveBlendNode->SetWeight(json["weight"].GetFloat());
+
+			blendNode = additiveBlendNode;
+		}
+		else if (json["type"] == "layer")
+		{
+			// Input 0 is the base pose, and input 1 the overlay
+			const auto layerBlendNode = blendTree->CreateNode<LayerBlendNode>();
+
+			if (json.HasMember("weight"))
+				layerBlendNode->SetWeight(json["weight"].GetFloat());
+
+			// The mask is a list of joints by name; each also applies to the joints below it unless "children" is false
+			// Later entries override earlier ones, so a subtree can be removed from a larger one
+			CHECK_MEMBER_REQUIRED(json, "mask")
+			const Skeleton& skeleton = *g_AnimixEngine->GetSkeleton(animator.GetTarget());
+			JointMask mask(skeleton);
+			for (const auto& maskJSON : json["mask"].GetArray())
+			{
+				CHECK_MEMBER_REQUIRED(maskJSON, "joint")
+				const int32_t joint = skeleton.FindJoint(gef::GetStringId(maskJSON["joint"].GetString()));
+				if (joint == -1)
+					return false;
+
+				const float weight = maskJSON.HasMember("weight") ? maskJSON["weight"].GetFloat() : 1.0f;
+				const bool children = maskJSON.HasMember("children") ? maskJSON["children"].GetBool() : true;
+				mask.SetWeight(skeleton, static_cast<size_t>(joint), weight, children);
+			}
+			layerBlendNode->SetMask(std::move(mask));
+
+			blendNode = layerBlendNode;
+		}
 		else if (json["type"] == "ragdoll")
 		{
 			const auto ragdollNode = blendTree->CreateNode<RagdollNode>();
@@ -349,6 +509,9 @@ namespace Animix
 			}
 		}
 
+		if (blendSpaceNode && !blendSpaceNode->Triangulate())
+			return false;
+
 		// Process observers
 		if (json.HasMember("observer"))
 		{
@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 
+#include "AnimationClip.h"
 #include "Skeleton.h"
 
 #include "rapidjson/document.h"
@@ -16,6 +17,56 @@ namespace gef
 
 namespace Animix
 {
+	// The pose an additive clip is the difference from
+	enum class AdditiveReference : uint8_t
+	{
+		// The bind pose of the target skeleton
+		BindPose,
+		// A single frame of a clip
+		ClipFrame
+	};
+
+	/**
+	 * Options controlling how an animation clip is processed as it is loaded
+	 */
+	struct ClipImportSettings
+	{
+		// Remove keys that can be recreated by interpolating their neighbours
+		// Tracks that never move further than the tolerance collapse to a single key
+		bool ReduceKeys = false;
+		// Maximum distance, in the units of the skeleton
+		float PositionTolerance = 0.01f;
+		// Maximum angle, in radians
+		float RotationTolerance = 0.001f;
+
+		// Resample the clip at this many frames per second, so that sampling does not need to search for keys
+		// 0 keeps the clip's original keys
+		float SampleRate = 0.0f;
+
+		// Store the clip as its difference from a reference pose, for layering with an AdditiveBlendNode
+		bool MakeAdditive = false;
+		AdditiveReference Reference = AdditiveReference::BindPose;
+		// For ClipFrame: the clip to take the reference frame from, which must already be loaded; empty uses the clip being loaded
+		std::string ReferenceClip;
+		float ReferenceTime = 0.0f;
+
+		// Quantize the clip's keys to reduce its memory footprint
+		bool Compress = false;
+		ClipCompressionSettings Compression;
+	};
+
+	/**
+	 * Statistics about a clip that has been loaded
+	 */
+	struct ClipImportReport
+	{
+		uint32_t KeysBeforeReduction = 0;
+		uint32_t KeysRemoved = 0;
+
+		ClipCompressionReport Compression;
+	};
+
+
 	/**
 	 * This class provides loader functions to make Animix work with gef's proprietary file formats
 	 */
@@ -31,7 +82,8 @@ namespace Animix
 		// Loads and then names a single animation from a scene
 		// Unfortunately this function is required since gef does not include the string table used to hash all the animation data
 		// with the animation data, so there is no way to retrieve the name of the animation from the .scn file itself
-		static bool LoadAndNameAnimationFromScene(const std::string& filename, SkeletonID target, const std::string& animName);
+		static bool LoadAndNameAnimationFromScene(const std::string& filename, SkeletonID target, const std::string& animName,
+			const ClipImportSettings& settings = ClipImportSettings(), ClipImportReport* outReport = nullptr);
 
 		static bool LoadAnimatorFromJSON(class Animator& animator, const std::string& filename);
 
@@ -39,6 +91,10 @@ namespace Animix
 		// Helper functions
 		static bool ReadGefSceneFromFile(const std::string& filename, gef::Scene* scene);
 
+		// Additive references; the reference must be checked before the clip is created
+		static bool IsValidAdditiveReference(const ClipImportSettings& settings, SkeletonID target);
+		static void BuildAdditiveReferencePose(const ClipImportSettings& settings, const AnimationClip& clip, SkeletonPose& outPose);
+
 		static bool LoadBlendNodeFromJSON(class Animator& animator, class BlendTree* blendTree, size_t& outNodeIndex, const rapidjson::Value& json);
 	};
 }
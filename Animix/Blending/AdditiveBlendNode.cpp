@@ -0,0 +1,88 @@
+#include "AdditiveBlendNode.h"
+
+#include "BlendTree.h"
+#include "Animix/AnimationEngine.h"
+
+
+namespace Animix
+{
+
+	AdditiveBlendNode::AdditiveBlendNode(BlendTree* tree, size_t index)
+		: BlendNode(tree, index)
+	{
+		// This node has a base input and an additive input
+		m_Inputs.resize(2, -1);
+	}
+
+	bool AdditiveBlendNode::IsValid() const
+	{
+		// Validate children
+		if (!(m_Tree->DoesNodeExist(m_Inputs.at(0))
+			&& m_Tree->DoesNodeExist(m_Inputs.at(1))))
+			return false;
+
+		return GetInputNode(0)->IsValid() && GetInputNode(1)->IsValid();
+	}
+
+	void AdditiveBlendNode::Tick(float deltaTime, float timeScale)
+	{
+		// Additive layers keep their own timing, rather than being scaled to match the base
+		GetInputNode(0)->Tick(deltaTime, timeScale);
+		GetInputNode(1)->Tick(deltaTime, timeScale);
+	}
+
+	void AdditiveBlendNode::Evaluate(SkeletonPose& outPose) const
+	{
+		ANIMIX_PROFILE_SCOPE_DETAIL("AdditiveBlendNode::Evaluate", 0, static_cast<uint32_t>(m_TreeIndex));
+
+		GetInputNode(0)->Evaluate(outPose);
+		if (m_Weight == 0.0f)
+			return;
+
+		const ScopedPose additive(g_AnimixEngine->GetFrameArena().GetPosePool(), outPose);
+		GetInputNode(1)->Evaluate(additive.Get());
+		SkeletonPose::Add(outPose, additive.Get(), m_Weight, outPose);
+	}
+
+	void AdditiveBlendNode::Compile(BlendProgram& program, BlendSlot out) const
+	{
+		program.BeginNode(*this, "AdditiveBlendNode::Evaluate");
+		const BlendSlot additive = program.AcquireSlots();
+		program.CompileInput(m_Inputs[0], out);
+
+		const size_t skip = program.BeginSkipIfWeight(&m_Weight, 0.0f);
+		program.CompileInput(m_Inputs[1], additive);
+		program.EmitAdd(out, additive, &m_Weight, out);
+		program.EndSkip(skip);
+
+		program.ReleaseSlots();
+		program.EndNode();
+	}
+
+	float AdditiveBlendNode::CalculateDuration() const
+	{
+		return GetInputNode(0)->CalculateDuration();
+	}
+
+	bool AdditiveBlendNode::IsLooping() const
+	{
+		return GetInputNode(0)->IsLooping();
+	}
+
+	bool AdditiveBlendNode::HasVariableWithName(const std::string& name)
+	{
+		if (name == "weight")
+			return true;
+
+		return false;
+	}
+
+	ParameterObserver AdditiveBlendNode::GetObserverForVariable(const std::string& name)
+	{
+		if (name == "weight")
+			return GetParamObserver_Weight();
+
+		return {};
+	}
+
+}
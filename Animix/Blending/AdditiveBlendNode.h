@@ -0,0 +1,60 @@
+#pragma once
+
+#include "BlendNode.h"
+
+
+namespace Animix
+{
+	/**
+	 * Layers an additive pose, such as breathing or recoil, on top of a base pose.
+	 * Input 0 is the base, and input 1 must only sample additive clips
+	 */
+	class AdditiveBlendNode : public BlendNode
+	{
+	public:
+		AdditiveBlendNode(BlendTree* tree, size_t index);
+		~AdditiveBlendNode() override = default;
+
+		// Disallow copying
+		AdditiveBlendNode(const AdditiveBlendNode&) = delete;
+		AdditiveBlendNode& operator=(const AdditiveBlendNode&) = delete;
+
+		// Default moving
+		AdditiveBlendNode(AdditiveBlendNode&&) = default;
+		AdditiveBlendNode& operator=(AdditiveBlendNode&&) = default;
+
+
+		// Implement BlendNode interface
+		virtual bool IsValid() const override;
+		virtual void Tick(float deltaTime, float timeScale) override;
+		virtual void Evaluate(SkeletonPose& outPose) const override;
+		virtual void Compile(BlendProgram& program, BlendSlot out) const override;
+		virtual float GetInputWeight(size_t inputIndex) const override { return inputIndex == 0 ? 1.0f : m_Weight; }
+
+		// The additive layer does not change the timing of the base
+		virtual float CalculateDuration() const override;
+		virtual bool IsLooping() const override;
+
+		virtual bool HasVariableWithName(const std::string& name) override;
+		virtual ParameterObserver GetObserverForVariable(const std::string& name) override;
+
+		// Methods for this type of node
+
+		// These setters are to be used on construction of the blend tree
+		// After tree construction, the node will be buried within the tree and difficult to access
+		// During game play, the parameter table and observer system should be used to manipulate node properties
+		inline void SetWeight(float weight) { m_Weight = weight; }
+
+		// Getters for observers for node parameters
+		inline ParameterObserver GetParamObserver_Weight()
+		{
+			return[this](float weight) { this->m_Weight = weight; };
+		}
+
+	protected:
+		// Additional parameters required by this node
+
+		// How much of the additive pose to apply; values above 1 exaggerate it
+		float m_Weight = 1.0f;
+	};
+}
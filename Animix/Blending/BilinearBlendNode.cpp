@@ -3,6 +3,7 @@
 #include <algorithm>
 
 #include "BlendTree.h"
+#include "Animix/AnimationEngine.h"
 
 
 namespace Animix
@@ -29,7 +30,7 @@ namespace Animix
 		return true;
 	}
 
-	void BilinearBlendNode::Tick(float timeScale)
+	void BilinearBlendNode::Tick(float deltaTime, float timeScale)
 	{
 		float in0_scale = 1.0f;
 		float in1_scale = 1.0f;
@@ -55,27 +56,87 @@ namespace Animix
 			in3_scale = targetDuration1 / dur2;
 		}
 
-		GetInputNode(0)->Tick(in0_scale * timeScale);
-		GetInputNode(1)->Tick(in1_scale * timeScale);
-		GetInputNode(2)->Tick(in2_scale * timeScale);
-		GetInputNode(3)->Tick(in3_scale * timeScale);
+		GetInputNode(0)->Tick(deltaTime, in0_scale * timeScale);
+		GetInputNode(1)->Tick(deltaTime, in1_scale * timeScale);
+		GetInputNode(2)->Tick(deltaTime, in2_scale * timeScale);
+		GetInputNode(3)->Tick(deltaTime, in3_scale * timeScale);
 	}
 
-	SkeletonPose BilinearBlendNode::Evaluate() const
+	void BilinearBlendNode::Evaluate(SkeletonPose& outPose) const
 	{
+		ANIMIX_PROFILE_SCOPE_DETAIL("BilinearBlendNode::Evaluate", 0, static_cast<uint32_t>(m_TreeIndex));
+
+		// At either end of beta, only one pair contributes
+		if (m_Beta == 0.0f || m_Beta == 1.0f)
+		{
+			EvaluatePair(m_Beta == 0.0f ? 0 : 2, outPose);
+			return;
+		}
+
 		// Perform blending
-		const SkeletonPose pose1(GetInputNode(0)->Evaluate());
-		const SkeletonPose pose2(GetInputNode(1)->Evaluate());
-		const SkeletonPose pose3(GetInputNode(2)->Evaluate());
-		const SkeletonPose pose4(GetInputNode(3)->Evaluate());
-
-		return SkeletonPose::Lerp(
-			SkeletonPose::Lerp(pose1, pose2, m_Alpha),
-			SkeletonPose::Lerp(pose3, pose4, m_Alpha),
-			m_Beta
-		);
+		// Blend the first pair of inputs into outPose, and the second pair into pose3
+		const ScopedPose pose3(g_AnimixEngine->GetFrameArena().GetPosePool(), outPose);
+		EvaluatePair(0, outPose);
+		EvaluatePair(2, pose3.Get());
+		SkeletonPose::Lerp(outPose, pose3.Get(), m_Beta, outPose);
+	}
+
+	void BilinearBlendNode::EvaluatePair(size_t first, SkeletonPose& outPose) const
+	{
+		if (m_Alpha == 0.0f || m_Alpha == 1.0f)
+		{
+			GetInputNode(m_Alpha == 0.0f ? first : first + 1)->Evaluate(outPose);
+			return;
+		}
+
+		const ScopedPose pose2Or4(g_AnimixEngine->GetFrameArena().GetPosePool(), outPose);
+		GetInputNode(first)->Evaluate(outPose);
+		GetInputNode(first + 1)->Evaluate(pose2Or4.Get());
+		SkeletonPose::Lerp(outPose, pose2Or4.Get(), m_Alpha, outPose);
+	}
+
+
+	void BilinearBlendNode::Compile(BlendProgram& program, BlendSlot out) const
+	{
+		program.BeginNode(*this, "BilinearBlendNode::Evaluate");
+
+		// The same order as Evaluate
+		const BlendSlot pose3 = program.AcquireSlots();
+		const BlendSlot pose2Or4 = program.AcquireSlots();
+
+		const size_t skipTop = program.BeginSkipIfWeight(&m_Beta, 1.0f);
+		CompilePair(program, 0, out, pose2Or4);
+		program.EndSkip(skipTop);
+
+		const size_t skipBottom = program.BeginSkipIfWeight(&m_Beta, 0.0f);
+		CompilePair(program, 2, pose3, pose2Or4);
+		program.EndSkip(skipBottom);
+
+		// Copies pose3 if beta is 1, and leaves out alone if it is 0
+		program.EmitBlend(out, pose3, &m_Beta, out);
+		program.ReleaseSlots(2);
+		program.EndNode();
 	}
 
+	void BilinearBlendNode::CompilePair(BlendProgram& program, size_t first, BlendSlot out, BlendSlot scratch) const
+	{
+		const size_t skipFirst = program.BeginSkipIfWeight(&m_Alpha, 1.0f);
+		program.CompileInput(m_Inputs[first], out);
+		program.EndSkip(skipFirst);
+
+		const size_t skipSecond = program.BeginSkipIfWeight(&m_Alpha, 0.0f);
+		program.CompileInput(m_Inputs[first + 1], scratch);
+		program.EndSkip(skipSecond);
+
+		program.EmitBlend(out, scratch, &m_Alpha, out);
+	}
+
+	float BilinearBlendNode::GetInputWeight(size_t inputIndex) const
+	{
+		const float alphaWeight = (inputIndex % 2 == 0) ? 1.0f - m_Alpha : m_Alpha;
+		const float betaWeight = (inputIndex < 2) ? 1.0f - m_Beta : m_Beta;
+		return alphaWeight * betaWeight;
+	}
 
 	float BilinearBlendNode::CalculateDuration() const
 	{
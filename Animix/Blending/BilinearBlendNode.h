@@ -23,8 +23,10 @@ namespace Animix
 
 		// Implement BlendNode interface
 		virtual bool IsValid() const override;
-		virtual void Tick(float timeScale) override;
-		virtual SkeletonPose Evaluate() const override;
+		virtual void Tick(float deltaTime, float timeScale) override;
+		virtual void Evaluate(SkeletonPose& outPose) const override;
+		virtual void Compile(BlendProgram& program, BlendSlot out) const override;
+		virtual float GetInputWeight(size_t inputIndex) const override;
 
 		virtual float CalculateDuration() const override;
 		virtual bool IsLooping() const override;
@@ -54,6 +56,10 @@ namespace Animix
 	private:
 		static float Lerp(float a, float b, float t);
 
+		// Blend inputs first and first + 1 by alpha
+		void EvaluatePair(size_t first, SkeletonPose& outPose) const;
+		void CompilePair(BlendProgram& program, size_t first, BlendSlot out, BlendSlot scratch) const;
+
 	protected:
 		// Additional parameters required by this node
 
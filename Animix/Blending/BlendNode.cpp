@@ -25,9 +25,26 @@ namespace Animix
 			return false;
 
 		m_Inputs[inputIndex] = inputNode;
+		m_Tree->InvalidateProgram();
 		return true;
 	}
 
+	bool BlendNode::HasChanged() const
+	{
+		for (size_t input = 0; input < m_Inputs.size(); input++)
+		{
+			// Inputs that are not evaluated cannot change the pose
+			if (GetInputWeight(input) != 0.0f && GetInputNode(input)->HasChanged())
+				return true;
+		}
+		return false;
+	}
+
+	void BlendNode::Compile(BlendProgram& program, BlendSlot out) const
+	{
+		program.EmitEvaluateNode(*this, out);
+	}
+
 	BlendNode* BlendNode::GetInputNode(size_t index) const
 	{
 		return m_Tree->GetNode(m_Inputs.at(index));
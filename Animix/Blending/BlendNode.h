@@ -3,6 +3,7 @@
 
 #include "../AnimixTypes.h"
 #include "../Skeleton.h"
+#include "BlendProgram.h"
 
 
 namespace Animix
@@ -32,8 +33,19 @@ namespace Animix
 		virtual bool IsValid() const = 0;
 		// Scale is an optional float that will scale the clips local timeline
 		// which is helpful for synchronizing animations
-		virtual void Tick(float timeScale = 1.0f) = 0;
-		virtual SkeletonPose Evaluate() const = 0;
+		// Delta time is passed down the tree, rather than read from the engine, so that animators can be updated on any thread
+		virtual void Tick(float deltaTime, float timeScale = 1.0f) = 0;
+		// Write the pose of this node into outPose, which is already sized for the target skeleton
+		// Any intermediate poses should be taken from the tree's pose pool, rather than allocated
+		virtual void Evaluate(SkeletonPose& outPose) const = 0;
+		// Could evaluating now give a different pose to the last evaluation
+		// Node variables only change through parameters, which the animator tracks, so by default a node changes when its inputs change
+		virtual bool HasChanged() const;
+		// How much an input contributes to the pose of this node; inputs with no weight are not evaluated
+		virtual float GetInputWeight(size_t inputIndex) const { return 1.0f; }
+		// Emit the instructions that evaluate this node into out, compiling inputs through the program
+		// By default, the program calls Evaluate
+		virtual void Compile(BlendProgram& program, BlendSlot out) const;
 
 		virtual float CalculateDuration() const { return 0.0f; }
 		virtual bool IsLooping() const { return false; }
@@ -0,0 +1,280 @@
+#include "BlendProgram.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "BlendNode.h"
+#include "BlendTree.h"
+#include "Animix/AnimationEngine.h"
+#include "Animix/ClipSampler.h"
+
+
+namespace Animix
+{
+	void BlendProgram::Compile(const BlendTree& tree, BlendNodeID root)
+	{
+		m_Instructions.clear();
+		m_SlotCount = 0;
+
+		m_Tree = &tree;
+		m_SlotsInUse = 0;
+
+		const BlendSlot out = AcquireSlots();
+		CompileInput(root, out);
+		ReleaseSlots();
+
+		assert(m_SlotsInUse == 0 && m_JointMasks.empty());
+		m_Tree = nullptr;
+	}
+
+	void BlendProgram::Run(SkeletonPose& outPose) const
+	{
+		FrameArena& arena = g_AnimixEngine->GetFrameArena();
+		PosePool& posePool = arena.GetPosePool();
+		Profiler& profiler = g_AnimixEngine->GetProfiler();
+
+		// Every slot other than the output lives for the whole program
+		const FrameArena::Marker marker = arena.GetMarker();
+		SkeletonPose** slots = arena.AllocateArray<SkeletonPose*>(m_SlotCount);
+		slots[0] = &outPose;
+		for (size_t slot = 1; slot < m_SlotCount; slot++)
+			slots[slot] = &posePool.Acquire(outPose.SkID);
+
+		const BlendInstruction* instructions = m_Instructions.data();
+		const size_t instructionCount = m_Instructions.size();
+		for (size_t index = 0; index < instructionCount; index++)
+		{
+			const BlendInstruction& instruction = instructions[index];
+
+			switch (instruction.Op)
+			{
+			case BlendOp::SampleClip:
+				instruction.Sampler->SampleLocalPose(*slots[instruction.Out]);
+				break;
+			case BlendOp::Blend:
+				SkeletonPose::Lerp(*slots[instruction.A], *slots[instruction.B], *instruction.Weight, *slots[instruction.Out]);
+				break;
+			case BlendOp::BlendSelected:
+				SkeletonPose::Lerp(*slots[instruction.A + *instruction.SelectA], *slots[instruction.A + *instruction.SelectB],
+					*instruction.Weight, *slots[instruction.Out]);
+				break;
+			case BlendOp::BlendWithSelected:
+				SkeletonPose::Lerp(*slots[instruction.A], *slots[instruction.B + *instruction.SelectB], *instruction.Weight, *slots[instruction.Out]);
+				break;
+			case BlendOp::Add:
+				SkeletonPose::Add(*slots[instruction.A], *slots[instruction.B], *instruction.Weight, *slots[instruction.Out]);
+				break;
+			case BlendOp::Layer:
+				SkeletonPose::Layer(*slots[instruction.A], *slots[instruction.B], *instruction.Mask, *instruction.Weight, *slots[instruction.Out]);
+				break;
+			case BlendOp::SetJointMask:
+				for (size_t slot = instruction.A; slot < instruction.B; slot++)
+					slots[slot]->Mask = instruction.Mask;
+				break;
+			case BlendOp::SkipIfWeight:
+				if (*instruction.Weight == instruction.Value)
+					index = instruction.Jump - 1;
+				break;
+			case BlendOp::SkipUnlessSelected:
+				if (!(instruction.Input == *instruction.SelectA && *instruction.Weight != 1.0f)
+					&& !(instruction.Input == *instruction.SelectB && *instruction.Weight != 0.0f))
+					index = instruction.Jump - 1;
+				break;
+			case BlendOp::EvaluateNode:
+				// The node profiles its own evaluation
+				instruction.Node->Evaluate(*slots[instruction.Out]);
+				break;
+			case BlendOp::BeginProfile:
+				if (profiler.IsEnabled())
+					profiler.BeginEvent(instruction.ProfileName, instruction.ProfileDetail, instruction.ProfileIndex);
+				break;
+			case BlendOp::EndProfile:
+				if (profiler.IsEnabled())
+					profiler.EndLastEvent();
+				break;
+			}
+		}
+
+		for (size_t slot = 1; slot < m_SlotCount; slot++)
+			posePool.Release();
+		arena.Rewind(marker);
+	}
+
+
+	void BlendProgram::CompileInput(BlendNodeID input, BlendSlot out)
+	{
+		assert(m_Tree && "Inputs can only be compiled while compiling a tree");
+		if (m_Tree->DoesNodeExist(input))
+			m_Tree->GetNode(input)->Compile(*this, out);
+	}
+
+	BlendSlot BlendProgram::AcquireSlots(size_t count)
+	{
+		const size_t first = m_SlotsInUse;
+		m_SlotsInUse += count;
+		m_SlotCount = std::max(m_SlotCount, m_SlotsInUse);
+
+		assert(m_SlotsInUse <= UINT16_MAX);
+		return static_cast<BlendSlot>(first);
+	}
+
+	void BlendProgram::ReleaseSlots(size_t count)
+	{
+		assert(count <= m_SlotsInUse);
+		m_SlotsInUse -= count;
+	}
+
+	void BlendProgram::EmitSampleClip(const ClipSampler& sampler, BlendSlot out)
+	{
+		BlendInstruction instruction;
+		instruction.Op = BlendOp::SampleClip;
+		instruction.Out = out;
+		instruction.Sampler = &sampler;
+		m_Instructions.push_back(instruction);
+	}
+
+	void BlendProgram::EmitBlend(BlendSlot a, BlendSlot b, const float* weight, BlendSlot out)
+	{
+		BlendInstruction instruction;
+		instruction.Op = BlendOp::Blend;
+		instruction.Out = out;
+		instruction.A = a;
+		instruction.B = b;
+		instruction.Weight = weight;
+		m_Instructions.push_back(instruction);
+	}
+
+	void BlendProgram::EmitBlendSelected(BlendSlot first, const size_t* selectA, const size_t* selectB, const float* weight, BlendSlot out)
+	{
+		BlendInstruction instruction;
+		instruction.Op = BlendOp::BlendSelected;
+		instruction.Out = out;
+		instruction.A = first;
+		instruction.SelectA = selectA;
+		instruction.SelectB = selectB;
+		instruction.Weight = weight;
+		m_Instructions.push_back(instruction);
+	}
+
+	void BlendProgram::EmitBlendWithSelected(BlendSlot a, BlendSlot first, const size_t* selectB, const float* weight, BlendSlot out)
+	{
+		BlendInstruction instruction;
+		instruction.Op = BlendOp::BlendWithSelected;
+		instruction.Out = out;
+		instruction.A = a;
+		instruction.B = first;
+		instruction.SelectB = selectB;
+		instruction.Weight = weight;
+		m_Instructions.push_back(instruction);
+	}
+
+	void BlendProgram::EmitAdd(BlendSlot base, BlendSlot additive, const float* weight, BlendSlot out)
+	{
+		BlendInstruction instruction;
+		instruction.Op = BlendOp::Add;
+		instruction.Out = out;
+		instruction.A = base;
+		instruction.B = additive;
+		instruction.Weight = weight;
+		m_Instructions.push_back(instruction);
+	}
+
+	void BlendProgram::EmitLayer(BlendSlot base, BlendSlot overlay, const JointMask& mask, const float* weight, BlendSlot out)
+	{
+		BlendInstruction instruction;
+		instruction.Op = BlendOp::Layer;
+		instruction.Out = out;
+		instruction.A = base;
+		instruction.B = overlay;
+		instruction.Mask = &mask;
+		instruction.Weight = weight;
+		m_Instructions.push_back(instruction);
+	}
+
+	void BlendProgram::EmitEvaluateNode(const BlendNode& node, BlendSlot out)
+	{
+		BlendInstruction instruction;
+		instruction.Op = BlendOp::EvaluateNode;
+		instruction.Out = out;
+		instruction.Node = &node;
+		m_Instructions.push_back(instruction);
+	}
+
+	void BlendProgram::BeginNode(const BlendNode& node, const char* profileName, NameID profileDetail)
+	{
+#if ANIMIX_PROFILE
+		BlendInstruction instruction;
+		instruction.Op = BlendOp::BeginProfile;
+		instruction.ProfileName = profileName;
+		instruction.ProfileDetail = profileDetail;
+		instruction.ProfileIndex = static_cast<uint32_t>(node.GetNodeID());
+		m_Instructions.push_back(instruction);
+#endif
+	}
+
+	void BlendProgram::EndNode()
+	{
+#if ANIMIX_PROFILE
+		BlendInstruction instruction;
+		instruction.Op = BlendOp::EndProfile;
+		m_Instructions.push_back(instruction);
+#endif
+	}
+
+	size_t BlendProgram::BeginSkipIfWeight(const float* weight, float value)
+	{
+		BlendInstruction instruction;
+		instruction.Op = BlendOp::SkipIfWeight;
+		instruction.Weight = weight;
+		instruction.Value = value;
+		m_Instructions.push_back(instruction);
+
+		return m_Instructions.size() - 1;
+	}
+
+	size_t BlendProgram::BeginSelectedInput(const size_t* selectA, const size_t* selectB, const float* weight, size_t input)
+	{
+		BlendInstruction instruction;
+		instruction.Op = BlendOp::SkipUnlessSelected;
+		instruction.Input = static_cast<uint32_t>(input);
+		instruction.SelectA = selectA;
+		instruction.SelectB = selectB;
+		instruction.Weight = weight;
+		m_Instructions.push_back(instruction);
+
+		return m_Instructions.size() - 1;
+	}
+
+	void BlendProgram::EndSkip(size_t begin)
+	{
+		assert(m_Instructions.at(begin).Op == BlendOp::SkipIfWeight || m_Instructions.at(begin).Op == BlendOp::SkipUnlessSelected);
+		m_Instructions[begin].Jump = static_cast<uint32_t>(m_Instructions.size());
+	}
+
+	void BlendProgram::BeginJointMask(const JointMask& mask, BlendSlot first)
+	{
+		// The last slot is not known until the instructions using the mask have been compiled
+		BlendInstruction instruction;
+		instruction.Op = BlendOp::SetJointMask;
+		instruction.A = first;
+		instruction.Mask = &mask;
+		m_Instructions.push_back(instruction);
+
+		m_JointMasks.push_back(m_Instructions.size() - 1);
+	}
+
+	void BlendProgram::EndJointMask()
+	{
+		assert(!m_JointMasks.empty());
+		BlendInstruction& begin = m_Instructions[m_JointMasks.back()];
+		m_JointMasks.pop_back();
+
+		// Every slot above first was only used under this mask, so the end of the range is the most slots used so far
+		begin.B = static_cast<BlendSlot>(m_SlotCount);
+
+		// Give the slots back the mask of the enclosing layer, since slots are shared with the rest of the tree
+		BlendInstruction instruction = begin;
+		instruction.Mask = m_JointMasks.empty() ? nullptr : m_Instructions[m_JointMasks.back()].Mask;
+		m_Instructions.push_back(instruction);
+	}
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../AnimixTypes.h"
+#include "../NameID.h"
+#include "../Skeleton.h"
+
+
+namespace Animix
+{
+	// Forward declarations
+	class BlendNode;
+	class BlendTree;
+	class ClipSampler;
+
+	// Poses the program evaluates into; slot 0 is the output pose
+	using BlendSlot = uint16_t;
+
+	enum class BlendOp : uint8_t
+	{
+		// Sample Sampler into Out
+		SampleClip,
+		// Blend A and B by *Weight into Out
+		Blend,
+		// Blend slots A + *SelectA and A + *SelectB by *Weight into Out
+		BlendSelected,
+		// Blend A and slot B + *SelectB by *Weight into Out
+		BlendWithSelected,
+		// Apply additive B to A, scaled by *Weight, into Out
+		Add,
+		// Blend the joints of Mask from A towards B, scaled by *Weight, into Out
+		Layer,
+		// Set the joint mask of slots A up to B to Mask
+		SetJointMask,
+		// Continue from instruction Jump if *Weight is Value
+		SkipIfWeight,
+		// Unless Input is *SelectA with a *Weight other than 1, or *SelectB with a *Weight other than 0, continue from instruction Jump
+		SkipUnlessSelected,
+		// Call Node->Evaluate into Out, for nodes that do not compile themselves
+		EvaluateNode,
+		// Open a profiler scope for the node ProfileIndex, named ProfileName, around the instructions up to the matching EndProfile
+		BeginProfile,
+		EndProfile
+	};
+
+	/**
+	 * One step of a compiled blend tree.
+	 * Operands point at the variables of the nodes they came from, so parameter changes are seen without recompiling
+	 */
+	struct BlendInstruction
+	{
+		BlendOp Op = BlendOp::EvaluateNode;
+		BlendSlot Out = 0;
+		BlendSlot A = 0;
+		BlendSlot B = 0;
+		uint32_t Input = 0;
+		uint32_t Jump = 0;
+		float Value = 0.0f;
+
+		const float* Weight = nullptr;
+		const size_t* SelectA = nullptr;
+		const size_t* SelectB = nullptr;
+		const ClipSampler* Sampler = nullptr;
+		const BlendNode* Node = nullptr;
+		const JointMask* Mask = nullptr;
+
+		// For BeginProfile; named after the node's Evaluate, so compiled and recursive trees report the same scopes
+		const char* ProfileName = "";
+		NameID ProfileDetail = 0;
+		uint32_t ProfileIndex = 0;
+	};
+
+	/**
+	 * A blend tree flattened into a list of instructions in evaluation order, run over a stack of pose slots.
+	 * Each node emits its own instructions when the tree is compiled, so evaluating needs no virtual calls or lookups of input nodes
+	 */
+	class BlendProgram
+	{
+	public:
+		BlendProgram() = default;
+		~BlendProgram() = default;
+
+		// Disallow copying
+		BlendProgram(const BlendProgram&) = delete;
+		BlendProgram& operator=(const BlendProgram&) = delete;
+
+		// Default moving
+		BlendProgram(BlendProgram&&) = default;
+		BlendProgram& operator=(BlendProgram&&) = default;
+
+
+		void Compile(const BlendTree& tree, BlendNodeID root);
+		// The tree must be valid, as when BlendTree::Tick succeeds
+		void Run(SkeletonPose& outPose) const;
+
+		inline size_t GetInstructionCount() const { return m_Instructions.size(); }
+		inline size_t GetSlotCount() const { return m_SlotCount; }
+
+		// Used by nodes to compile themselves
+		// Inputs that do not exist are skipped; the node cannot be valid, so the program will not be run
+		void CompileInput(BlendNodeID input, BlendSlot out);
+		// Slots are taken and returned in stack order
+		BlendSlot AcquireSlots(size_t count = 1);
+		void ReleaseSlots(size_t count = 1);
+
+		void EmitSampleClip(const ClipSampler& sampler, BlendSlot out);
+		void EmitBlend(BlendSlot a, BlendSlot b, const float* weight, BlendSlot out);
+		void EmitBlendSelected(BlendSlot first, const size_t* selectA, const size_t* selectB, const float* weight, BlendSlot out);
+		void EmitBlendWithSelected(BlendSlot a, BlendSlot first, const size_t* selectB, const float* weight, BlendSlot out);
+		void EmitAdd(BlendSlot base, BlendSlot additive, const float* weight, BlendSlot out);
+		void EmitLayer(BlendSlot base, BlendSlot overlay, const JointMask& mask, const float* weight, BlendSlot out);
+		void EmitEvaluateNode(const BlendNode& node, BlendSlot out);
+
+		// Everything a node compiles, including its inputs, is timed as one call of its Evaluate
+		void BeginNode(const BlendNode& node, const char* profileName, NameID profileDetail = 0);
+		void EndNode();
+
+		// Instructions emitted from these until EndSkip are skipped when the weight is value, or unless the input is selected
+		// Inputs with no weight are still ticked, so they stay in sync for when they are evaluated again
+		size_t BeginSkipIfWeight(const float* weight, float value);
+		size_t BeginSelectedInput(const size_t* selectA, const size_t* selectB, const float* weight, size_t input);
+		void EndSkip(size_t begin);
+
+		// Slots from first that are used by the instructions emitted until EndJointMask only need the joints of the mask
+		void BeginJointMask(const JointMask& mask, BlendSlot first);
+		void EndJointMask();
+
+	private:
+		std::vector<BlendInstruction> m_Instructions;
+		size_t m_SlotCount = 0;
+
+		// Only used while compiling
+		const BlendTree* m_Tree = nullptr;
+		size_t m_SlotsInUse = 0;
+		// The SetJointMask instructions of the masks being compiled
+		std::vector<size_t> m_JointMasks;
+	};
+}
@@ -0,0 +1,511 @@
+#include "BlendSpace2DNode.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "BlendTree.h"
+#include "Animix/AnimationEngine.h"
+
+
+namespace Animix
+{
+
+	BlendSpace2DNode::BlendSpace2DNode(BlendTree* tree, size_t index)
+		: BlendNode(tree, index)
+	{
+		// This node requires at least three inputs to cover an area
+		m_Inputs.resize(3, -1);
+		m_InputWeights.resize(3, 0.0f);
+		// default positions for the inputs
+		m_InputPositions = {
+			{ 0.0f, 0.0f },
+			{ 1.0f, 0.0f },
+			{ 0.0f, 1.0f }
+		};
+	}
+
+	bool BlendSpace2DNode::IsValid() const
+	{
+		// Validate parameters
+		if (m_Triangles.empty() || m_Inputs.size() != m_InputPositions.size())
+			return false;
+
+		// Validate children; every input is ticked, so every input must be valid
+		for (size_t input = 0; input < m_Inputs.size(); input++)
+		{
+			if (!m_Tree->DoesNodeExist(m_Inputs[input]))
+				return false;
+			if (!GetInputNode(input)->IsValid())
+				return false;
+
+			if (m_ScaleClips && GetInputNode(input)->CalculateDuration() == 0.0f)
+				return false;
+		}
+
+		return true;
+	}
+
+	void BlendSpace2DNode::Tick(float deltaTime, float timeScale)
+	{
+		// The position only needs to be looked up once per tick, however many times it was set
+		UpdateSelection();
+
+		const float targetDuration = m_ScaleClips ? CalculateDuration() : 0.0f;
+
+		// Tick every input, so that inputs stay in sync as the position moves between triangles
+		for (size_t input = 0; input < m_Inputs.size(); input++)
+		{
+			// Scale each input to the blended duration, so that all inputs stay in phase
+			const float scale = m_ScaleClips ? GetInputNode(input)->CalculateDuration() / targetDuration : 1.0f;
+			GetInputNode(input)->Tick(deltaTime, scale * timeScale);
+		}
+	}
+
+	void BlendSpace2DNode::Evaluate(SkeletonPose& outPose) const
+	{
+		ANIMIX_PROFILE_SCOPE_DETAIL("BlendSpace2DNode::Evaluate", 0, static_cast<uint32_t>(m_TreeIndex));
+
+		// Inputs are selected by decreasing weight, so evaluation stops at the first without weight
+		GetInputNode(m_Selected[0])->Evaluate(outPose);
+		if (m_SelectedWeights[1] == 0.0f)
+			return;
+
+		const ScopedPose other(g_AnimixEngine->GetFrameArena().GetPosePool(), outPose);
+		GetInputNode(m_Selected[1])->Evaluate(other.Get());
+		SkeletonPose::Lerp(outPose, other.Get(), m_PairAlpha, outPose);
+		if (m_SelectedWeights[2] == 0.0f)
+			return;
+
+		GetInputNode(m_Selected[2])->Evaluate(other.Get());
+		SkeletonPose::Lerp(outPose, other.Get(), m_ThirdAlpha, outPose);
+	}
+
+	void BlendSpace2DNode::Compile(BlendProgram& program, BlendSlot out) const
+	{
+		program.BeginNode(*this, "BlendSpace2DNode::Evaluate");
+
+		// Every input gets a slot, and only the inputs with weight are evaluated
+		const BlendSlot first = program.AcquireSlots(m_Inputs.size());
+		for (size_t input = 0; input < m_Inputs.size(); input++)
+		{
+			const size_t skip = program.BeginSkipIfWeight(&m_InputWeights[input], 0.0f);
+			program.CompileInput(m_Inputs[input], static_cast<BlendSlot>(first + input));
+			program.EndSkip(skip);
+		}
+
+		// Unused selections repeat the first input with an alpha of 0, which copies it, then leaves the pose alone
+		program.EmitBlendSelected(first, &m_Selected[0], &m_Selected[1], &m_PairAlpha, out);
+		program.EmitBlendWithSelected(out, first, &m_Selected[2], &m_ThirdAlpha, out);
+		program.ReleaseSlots(m_Inputs.size());
+		program.EndNode();
+	}
+
+	float BlendSpace2DNode::GetInputWeight(size_t inputIndex) const
+	{
+		return m_InputWeights.at(inputIndex);
+	}
+
+	float BlendSpace2DNode::CalculateDuration() const
+	{
+		if (m_ScaleClips)
+		{
+			// Scaled inputs all take the blended duration
+			float duration = 0.0f;
+			for (size_t i = 0; i < 3; i++)
+				duration += m_SelectedWeights[i] * GetInputNode(m_Selected[i])->CalculateDuration();
+			return duration;
+		}
+
+		float duration = 0.0f;
+		for (size_t i = 0; i < 3; i++)
+			duration = std::max(duration, GetInputNode(m_Selected[i])->CalculateDuration());
+		return duration;
+	}
+
+	bool BlendSpace2DNode::IsLooping() const
+	{
+		return GetInputNode(m_Selected[0])->IsLooping() && GetInputNode(m_Selected[1])->IsLooping()
+			&& GetInputNode(m_Selected[2])->IsLooping();
+	}
+
+	bool BlendSpace2DNode::HasVariableWithName(const std::string& name)
+	{
+		if (name == "x")
+			return true;
+		if (name == "y")
+			return true;
+
+		return false;
+	}
+
+	ParameterObserver BlendSpace2DNode::GetObserverForVariable(const std::string& name)
+	{
+		if (name == "x")
+			return GetParamObserver_X();
+		if (name == "y")
+			return GetParamObserver_Y();
+
+		return {};
+	}
+
+	bool BlendSpace2DNode::SetInput(size_t inputIndex, BlendNodeID inputNode)
+	{
+		// Make sure child is a valid index
+		if (!m_Tree->DoesNodeExist(inputNode))
+			return false;
+
+		// Inputs can be of any size, so long as there are no gaps
+		// This is ensured by only allowing inputs to be added sequentially
+		if (inputIndex > m_Inputs.size())
+			return false;
+
+		if (inputIndex == m_Inputs.size())
+		{
+			m_Inputs.push_back(inputNode);
+			m_InputWeights.push_back(0.0f);
+		}
+		else
+		{
+			m_Inputs[inputIndex] = inputNode;
+		}
+		m_Tree->InvalidateProgram();
+
+		return true;
+	}
+
+	void BlendSpace2DNode::SetPositionForInput(size_t inputIndex, float x, float y)
+	{
+		if (inputIndex >= m_InputPositions.size())
+			m_InputPositions.resize(inputIndex + 1);
+		m_InputPositions[inputIndex] = { x, y };
+
+		// The inputs must be triangulated again before the node is valid
+		m_Triangles.clear();
+	}
+
+
+	bool BlendSpace2DNode::Triangulate()
+	{
+		m_Triangles.clear();
+		m_HullEdges.clear();
+
+		const size_t count = m_InputPositions.size();
+		if (count < 3 || count != m_Inputs.size())
+			return false;
+
+		// Inputs in the same place cannot be told apart
+		for (size_t a = 0; a < count; a++)
+		{
+			for (size_t b = a + 1; b < count; b++)
+			{
+				if (m_InputPositions[a].X == m_InputPositions[b].X && m_InputPositions[a].Y == m_InputPositions[b].Y)
+					return false;
+			}
+		}
+
+		Point boundsMin = m_InputPositions[0];
+		Point boundsMax = m_InputPositions[0];
+		for (const Point& p : m_InputPositions)
+		{
+			boundsMin = { std::min(boundsMin.X, p.X), std::min(boundsMin.Y, p.Y) };
+			boundsMax = { std::max(boundsMax.X, p.X), std::max(boundsMax.Y, p.Y) };
+		}
+		if (boundsMax.X == boundsMin.X || boundsMax.Y == boundsMin.Y)
+			return false;
+
+		// Bowyer-Watson: insert the inputs one at a time into a triangle that encloses all of them,
+		// replacing every triangle whose circumcircle contains the new input with a fan around it.
+		// Blend spaces only have a handful of inputs, so this is done without any acceleration
+		std::vector<Point> points = m_InputPositions;
+		const float extent = std::max(boundsMax.X - boundsMin.X, boundsMax.Y - boundsMin.Y);
+		const Point mid = { 0.5f * (boundsMin.X + boundsMax.X), 0.5f * (boundsMin.Y + boundsMax.Y) };
+		points.push_back({ mid.X - 20.0f * extent, mid.Y - extent });
+		points.push_back({ mid.X, mid.Y + 20.0f * extent });
+		points.push_back({ mid.X + 20.0f * extent, mid.Y - extent });
+
+		struct WorkingTriangle
+		{
+			uint32_t Vertices[3];
+			Point Centre;
+			float RadiusSq;
+		};
+		const auto makeTriangle = [&points](uint32_t a, uint32_t b, uint32_t c)
+		{
+			const Point& pa = points[a];
+			const Point& pb = points[b];
+			const Point& pc = points[c];
+			const float d = 2.0f * (pa.X * (pb.Y - pc.Y) + pb.X * (pc.Y - pa.Y) + pc.X * (pa.Y - pb.Y));
+
+			WorkingTriangle triangle = { { a, b, c }, {}, std::numeric_limits<float>::infinity() };
+			if (d != 0.0f)
+			{
+				const float sa = pa.X * pa.X + pa.Y * pa.Y;
+				const float sb = pb.X * pb.X + pb.Y * pb.Y;
+				const float sc = pc.X * pc.X + pc.Y * pc.Y;
+				triangle.Centre = {
+					(sa * (pb.Y - pc.Y) + sb * (pc.Y - pa.Y) + sc * (pa.Y - pb.Y)) / d,
+					(sa * (pc.X - pb.X) + sb * (pa.X - pc.X) + sc * (pb.X - pa.X)) / d
+				};
+				const float dx = pa.X - triangle.Centre.X;
+				const float dy = pa.Y - triangle.Centre.Y;
+				triangle.RadiusSq = dx * dx + dy * dy;
+			}
+			return triangle;
+		};
+
+		const uint32_t super = static_cast<uint32_t>(count);
+		std::vector<WorkingTriangle> triangles = { makeTriangle(super, super + 1, super + 2) };
+		std::vector<std::pair<uint32_t, uint32_t>> edges;
+		for (uint32_t input = 0; input < count; input++)
+		{
+			const Point& p = points[input];
+
+			// Remove the triangles whose circumcircle contains p, keeping the edges of the hole they leave
+			edges.clear();
+			for (size_t t = 0; t < triangles.size();)
+			{
+				const WorkingTriangle& triangle = triangles[t];
+				const float dx = p.X - triangle.Centre.X;
+				const float dy = p.Y - triangle.Centre.Y;
+				if (dx * dx + dy * dy <= triangle.RadiusSq)
+				{
+					for (size_t v = 0; v < 3; v++)
+					{
+						const uint32_t a = triangle.Vertices[v];
+						const uint32_t b = triangle.Vertices[(v + 1) % 3];
+						edges.emplace_back(std::min(a, b), std::max(a, b));
+					}
+					triangles[t] = triangles.back();
+					triangles.pop_back();
+				}
+				else
+				{
+					t++;
+				}
+			}
+
+			// Edges shared by two removed triangles are inside the hole
+			std::sort(edges.begin(), edges.end());
+			for (size_t e = 0; e < edges.size(); e++)
+			{
+				if (e + 1 < edges.size() && edges[e] == edges[e + 1])
+				{
+					e++;
+					continue;
+				}
+				if (e > 0 && edges[e] == edges[e - 1])
+					continue;
+
+				triangles.push_back(makeTriangle(edges[e].first, edges[e].second, input));
+			}
+		}
+
+		// Keep the triangles that only use inputs, and precalculate what is needed for barycentric coordinates
+		edges.clear();
+		for (const WorkingTriangle& working : triangles)
+		{
+			if (working.Vertices[0] >= super || working.Vertices[1] >= super || working.Vertices[2] >= super)
+				continue;
+
+			Triangle triangle;
+			std::copy(working.Vertices, working.Vertices + 3, triangle.Inputs);
+			triangle.Origin = points[triangle.Inputs[0]];
+			triangle.Edge1 = { points[triangle.Inputs[1]].X - triangle.Origin.X, points[triangle.Inputs[1]].Y - triangle.Origin.Y };
+			triangle.Edge2 = { points[triangle.Inputs[2]].X - triangle.Origin.X, points[triangle.Inputs[2]].Y - triangle.Origin.Y };
+
+			const float area = triangle.Edge1.X * triangle.Edge2.Y - triangle.Edge2.X * triangle.Edge1.Y;
+			if (std::fabs(area) <= 1e-6f * extent * extent)
+				continue;
+			triangle.InvArea = 1.0f / area;
+			m_Triangles.push_back(triangle);
+
+			for (size_t v = 0; v < 3; v++)
+			{
+				const uint32_t a = triangle.Inputs[v];
+				const uint32_t b = triangle.Inputs[(v + 1) % 3];
+				edges.emplace_back(std::min(a, b), std::max(a, b));
+			}
+		}
+		if (m_Triangles.empty())
+			return false;
+
+		// Edges that only belong to one triangle are on the outside
+		std::sort(edges.begin(), edges.end());
+		for (size_t e = 0; e < edges.size(); e++)
+		{
+			if (e + 1 < edges.size() && edges[e] == edges[e + 1])
+			{
+				e++;
+				continue;
+			}
+			m_HullEdges.push_back(edges[e]);
+		}
+
+		m_GridMin = boundsMin;
+		BuildGrid();
+		UpdateSelection();
+		return true;
+	}
+
+	void BlendSpace2DNode::BuildGrid()
+	{
+		// Roughly one triangle per cell
+		m_GridSize = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(m_Triangles.size())))));
+
+		Point boundsMax = m_GridMin;
+		for (const Point& p : m_InputPositions)
+			boundsMax = { std::max(boundsMax.X, p.X), std::max(boundsMax.Y, p.Y) };
+		m_InvCellSize = {
+			static_cast<float>(m_GridSize) / (boundsMax.X - m_GridMin.X),
+			static_cast<float>(m_GridSize) / (boundsMax.Y - m_GridMin.Y)
+		};
+
+		const auto cellOf = [this](float value, float min, float invCellSize)
+		{
+			const int32_t cell = static_cast<int32_t>((value - min) * invCellSize);
+			return static_cast<uint32_t>(std::min(std::max(cell, 0), static_cast<int32_t>(m_GridSize) - 1));
+		};
+
+		// Each triangle is added to every cell its bounds overlap; count them first, so the lists can be packed together
+		const size_t cellCount = m_GridSize * m_GridSize;
+		std::vector<uint32_t> cellRanges(m_Triangles.size() * 4);
+		m_CellStarts.assign(cellCount + 1, 0);
+		for (size_t t = 0; t < m_Triangles.size(); t++)
+		{
+			float minX = std::numeric_limits<float>::max(), minY = minX;
+			float maxX = std::numeric_limits<float>::lowest(), maxY = maxX;
+			for (const uint32_t input : m_Triangles[t].Inputs)
+			{
+				minX = std::min(minX, m_InputPositions[input].X);
+				minY = std::min(minY, m_InputPositions[input].Y);
+				maxX = std::max(maxX, m_InputPositions[input].X);
+				maxY = std::max(maxY, m_InputPositions[input].Y);
+			}
+
+			uint32_t* range = &cellRanges[t * 4];
+			range[0] = cellOf(minX, m_GridMin.X, m_InvCellSize.X);
+			range[1] = cellOf(maxX, m_GridMin.X, m_InvCellSize.X);
+			range[2] = cellOf(minY, m_GridMin.Y, m_InvCellSize.Y);
+			range[3] = cellOf(maxY, m_GridMin.Y, m_InvCellSize.Y);
+			for (uint32_t y = range[2]; y <= range[3]; y++)
+				for (uint32_t x = range[0]; x <= range[1]; x++)
+					m_CellStarts[y * m_GridSize + x + 1]++;
+		}
+
+		for (size_t cell = 0; cell < cellCount; cell++)
+			m_CellStarts[cell + 1] += m_CellStarts[cell];
+
+		m_CellTriangles.resize(m_CellStarts[cellCount]);
+		std::vector<uint32_t> cellFill(m_CellStarts.begin(), m_CellStarts.end() - 1);
+		for (uint32_t t = 0; t < m_Triangles.size(); t++)
+		{
+			const uint32_t* range = &cellRanges[t * 4];
+			for (uint32_t y = range[2]; y <= range[3]; y++)
+				for (uint32_t x = range[0]; x <= range[1]; x++)
+					m_CellTriangles[cellFill[y * m_GridSize + x]++] = t;
+		}
+	}
+
+	void BlendSpace2DNode::UpdateSelection()
+	{
+		if (m_Triangles.empty())
+			return;
+
+		for (const size_t input : m_Selected)
+			m_InputWeights[input] = 0.0f;
+
+		const Point p = { m_X, m_Y };
+		if (!FindContainingTriangle(p))
+			SelectNearestEdge(p);
+
+		// Sort the selection by decreasing weight, so that the first input always has weight
+		for (size_t i = 1; i < 3; i++)
+		{
+			for (size_t j = i; j > 0 && m_SelectedWeights[j] > m_SelectedWeights[j - 1]; j--)
+			{
+				std::swap(m_Selected[j], m_Selected[j - 1]);
+				std::swap(m_SelectedWeights[j], m_SelectedWeights[j - 1]);
+			}
+		}
+		for (size_t i = 1; i < 3; i++)
+		{
+			if (m_SelectedWeights[i] == 0.0f)
+				m_Selected[i] = m_Selected[0];
+		}
+
+		for (size_t i = 0; i < 3; i++)
+			m_InputWeights[m_Selected[i]] += m_SelectedWeights[i];
+
+		// Blend the first two by their share of both, then in the third by its own weight
+		const float pairWeight = m_SelectedWeights[0] + m_SelectedWeights[1];
+		m_PairAlpha = m_SelectedWeights[1] / pairWeight;
+		m_ThirdAlpha = m_SelectedWeights[2];
+	}
+
+	bool BlendSpace2DNode::FindContainingTriangle(const Point& p)
+	{
+		const float cellX = (p.X - m_GridMin.X) * m_InvCellSize.X;
+		const float cellY = (p.Y - m_GridMin.Y) * m_InvCellSize.Y;
+		const float gridSize = static_cast<float>(m_GridSize);
+		if (cellX < 0.0f || cellY < 0.0f || cellX > gridSize || cellY > gridSize)
+			return false;
+
+		// Points on the far edges of the grid belong to the last cells
+		const uint32_t cell = std::min(static_cast<uint32_t>(cellY), m_GridSize - 1) * m_GridSize
+			+ std::min(static_cast<uint32_t>(cellX), m_GridSize - 1);
+
+		// Allow for points on an edge shared by two triangles
+		constexpr float TOLERANCE = 1e-5f;
+		for (uint32_t index = m_CellStarts[cell]; index < m_CellStarts[cell + 1]; index++)
+		{
+			const Triangle& triangle = m_Triangles[m_CellTriangles[index]];
+			const float dx = p.X - triangle.Origin.X;
+			const float dy = p.Y - triangle.Origin.Y;
+			const float u = (dx * triangle.Edge2.Y - triangle.Edge2.X * dy) * triangle.InvArea;
+			const float v = (triangle.Edge1.X * dy - dx * triangle.Edge1.Y) * triangle.InvArea;
+			if (u < -TOLERANCE || v < -TOLERANCE || u + v > 1.0f + TOLERANCE)
+				continue;
+
+			// Remove any error from the tolerance, so that the weights are never negative and always sum to 1
+			float weights[3] = { std::max(0.0f, 1.0f - u - v), std::max(0.0f, u), std::max(0.0f, v) };
+			const float total = weights[0] + weights[1] + weights[2];
+			for (size_t i = 0; i < 3; i++)
+			{
+				m_Selected[i] = triangle.Inputs[i];
+				m_SelectedWeights[i] = weights[i] / total;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	void BlendSpace2DNode::SelectNearestEdge(const Point& p)
+	{
+		float nearestDistanceSq = std::numeric_limits<float>::max();
+		for (const auto& edge : m_HullEdges)
+		{
+			const Point& a = m_InputPositions[edge.first];
+			const Point& b = m_InputPositions[edge.second];
+			const float ex = b.X - a.X;
+			const float ey = b.Y - a.Y;
+
+			// The closest point on the edge
+			const float t = std::min(std::max(((p.X - a.X) * ex + (p.Y - a.Y) * ey) / (ex * ex + ey * ey), 0.0f), 1.0f);
+			const float dx = a.X + t * ex - p.X;
+			const float dy = a.Y + t * ey - p.Y;
+			const float distanceSq = dx * dx + dy * dy;
+			if (distanceSq < nearestDistanceSq)
+			{
+				nearestDistanceSq = distanceSq;
+				m_Selected[0] = edge.first;
+				m_Selected[1] = edge.second;
+				m_Selected[2] = edge.first;
+				m_SelectedWeights[0] = 1.0f - t;
+				m_SelectedWeights[1] = t;
+				m_SelectedWeights[2] = 0.0f;
+			}
+		}
+	}
+
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+
+#include "BlendNode.h"
+
+
+namespace Animix
+{
+	/*
+	 * A 2D blend space, with any number of inputs placed anywhere on a plane.
+	 * The inputs are triangulated, and only the (up to) three inputs of the triangle containing the
+	 * blend position are evaluated. Positions outside of the inputs are moved to the nearest edge
+	*/
+	class BlendSpace2DNode : public BlendNode
+	{
+	public:
+		BlendSpace2DNode(BlendTree* tree, size_t index);
+		~BlendSpace2DNode() override = default;
+
+		// Disallow copying
+		BlendSpace2DNode(const BlendSpace2DNode&) = delete;
+		BlendSpace2DNode& operator=(const BlendSpace2DNode&) = delete;
+
+		// Default moving
+		BlendSpace2DNode(BlendSpace2DNode&&) = default;
+		BlendSpace2DNode& operator=(BlendSpace2DNode&&) = default;
+
+
+		// Implement BlendNode interface
+		virtual bool IsValid() const override;
+		virtual void Tick(float deltaTime, float timeScale) override;
+		virtual void Evaluate(SkeletonPose& outPose) const override;
+		virtual void Compile(BlendProgram& program, BlendSlot out) const override;
+		virtual float GetInputWeight(size_t inputIndex) const override;
+
+		virtual float CalculateDuration() const override;
+		virtual bool IsLooping() const override;
+
+		virtual bool HasVariableWithName(const std::string& name) override;
+		virtual ParameterObserver GetObserverForVariable(const std::string& name) override;
+
+		virtual bool SetInput(size_t inputIndex, BlendNodeID inputNode) override;
+
+		// Methods for this type of node
+
+		// These setters are to be used on construction of the blend tree
+		// After tree construction, the node will be buried within the tree and difficult to access
+		// During game play, the parameter table and observer system should be used to manipulate node properties
+		inline void SetScaleClips(bool scaleClips) { m_ScaleClips = scaleClips; }
+		inline void SetPosition(float x, float y) { m_X = x; m_Y = y; }
+		void SetPositionForInput(size_t inputIndex, float x, float y);
+
+		// Delaunay triangulate the inputs; must be called once every input has been placed
+		// Returns false if the inputs do not cover an area, such as when they are all on a line
+		bool Triangulate();
+
+		inline size_t GetTriangleCount() const { return m_Triangles.size(); }
+
+		// Getters for observers for node parameters
+		inline ParameterObserver GetParamObserver_X()
+		{
+			return[this](float x) { this->m_X = x; };
+		}
+		inline ParameterObserver GetParamObserver_Y()
+		{
+			return[this](float y) { this->m_Y = y; };
+		}
+
+	private:
+		struct Point
+		{
+			float X = 0.0f;
+			float Y = 0.0f;
+		};
+
+		// Find the inputs around the blend position and their weights
+		void UpdateSelection();
+		// Returns false if the point is not inside any triangle
+		bool FindContainingTriangle(const Point& p);
+		void SelectNearestEdge(const Point& p);
+
+		void BuildGrid();
+
+	protected:
+		// Additional parameters required by this node
+
+		// Should this node scale its inputs to make them all the same duration?
+		bool m_ScaleClips = true;
+
+		// The blending parameters
+		float m_X = 0.0f;
+		float m_Y = 0.0f;
+
+		// Where each input is placed in the blend space
+		std::vector<Point> m_InputPositions;
+
+		struct Triangle
+		{
+			uint32_t Inputs[3];
+			// For barycentric coordinates: the position of the first input, the edges to the other two,
+			// and the inverse of their cross product
+			Point Origin;
+			Point Edge1;
+			Point Edge2;
+			float InvArea = 0.0f;
+		};
+		std::vector<Triangle> m_Triangles;
+		// Edges on the outside of the triangulation, for blend positions outside of it
+		std::vector<std::pair<uint32_t, uint32_t>> m_HullEdges;
+
+		// A uniform grid over the bounds of the inputs; each cell lists the triangles that overlap it
+		Point m_GridMin;
+		Point m_InvCellSize;
+		uint32_t m_GridSize = 0;
+		std::vector<uint32_t> m_CellStarts;
+		std::vector<uint32_t> m_CellTriangles;
+
+		// The inputs currently being sampled, by decreasing weight; inputs without weight repeat the first input
+		size_t m_Selected[3] = { 0, 0, 0 };
+		float m_SelectedWeights[3] = { 1.0f, 0.0f, 0.0f };
+		// The blends that combine the selected inputs: the first two, then that with the third
+		float m_PairAlpha = 0.0f;
+		float m_ThirdAlpha = 0.0f;
+		// The weight of every input, which is zero for all but the selected inputs
+		std::vector<float> m_InputWeights;
+	};
+}
@@ -1,22 +1,65 @@
 #include "BlendTree.h"
 
+#include <cassert>
+
 #include "Animix/AnimationEngine.h"
 
 
 namespace Animix
 {
-	bool BlendTree::TickAndEvaluateTree(SkeletonPose& outPose, float timeScale) const
+	bool BlendTree::TickAndEvaluateTree(SkeletonPose& outPose, float deltaTime, float timeScale) const
+	{
+		if (!Tick(deltaTime, timeScale))
+			return false;
+
+		Evaluate(outPose);
+		return true;
+	}
+
+	bool BlendTree::Tick(float deltaTime, float timeScale) const
 	{
+		ANIMIX_PROFILE_SCOPE("BlendTree::Tick");
+
 		if (m_BlendTree.empty() || !Root()->IsValid())
 			return false;
 
+		// Trees are only ticked by their own animator, so may be compiled here
+		if (m_ProgramDirty)
+		{
+			m_Program.Compile(*this, m_OutputNode);
+			m_ProgramDirty = false;
+		}
+
 		// Tick all nodes in the tree
-		Root()->Tick(timeScale);
-		// Evaluate the pose of the tree
-		outPose = Root()->Evaluate();
+		Root()->Tick(deltaTime, timeScale);
 		return true;
 	}
 
+	void BlendTree::Evaluate(SkeletonPose& outPose) const
+	{
+		ANIMIX_PROFILE_SCOPE("BlendTree::Evaluate");
+
+		// Evaluate the pose of the tree
+		if (g_AnimixEngine->GetCompiledBlendTrees())
+		{
+			assert(!m_ProgramDirty && "The tree must be ticked before it is evaluated");
+			m_Program.Run(outPose);
+		}
+		else
+		{
+			Root()->Evaluate(outPose);
+		}
+	}
+
+	bool BlendTree::HasChanged() const
+	{
+		// An invalid tree always results in the bind pose
+		if (m_BlendTree.empty() || !Root()->IsValid())
+			return false;
+
+		return Root()->HasChanged();
+	}
+
 	float BlendTree::CalculateRemainingDuration() const
 	{
 		// Calculate if the animation of this tree has completed
@@ -60,6 +103,7 @@ namespace Animix
 			return false;
 
 		m_OutputNode = index;
+		InvalidateProgram();
 		return true;
 	}
 }
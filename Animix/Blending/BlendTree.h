@@ -5,6 +5,7 @@
 
 #include "../AnimixTypes.h"
 #include "BlendNode.h"
+#include "BlendProgram.h"
 
 namespace Animix
 {
@@ -24,7 +25,13 @@ namespace Animix
 		BlendTree& operator=(BlendTree&&) = default;
 
 
-		bool TickAndEvaluateTree(SkeletonPose& outPose, float timeScale = 1.0f) const;
+		bool TickAndEvaluateTree(SkeletonPose& outPose, float deltaTime, float timeScale = 1.0f) const;
+
+		// Ticking and evaluating separately allows evaluation to be skipped when the tree has not changed
+		// Returns false if the tree is not valid, in which case it should not be evaluated
+		bool Tick(float deltaTime, float timeScale = 1.0f) const;
+		void Evaluate(SkeletonPose& outPose) const;
+		bool HasChanged() const;
 
 		float CalculateRemainingDuration() const;
 		float CalculateDuration() const;
@@ -40,6 +47,7 @@ namespace Animix
 			static_assert(std::is_base_of<BlendNode, T>::value, "T is not a type of BlendNode");
 
 			m_BlendTree.emplace_back(std::make_unique<T>(this, m_BlendTree.size()));
+			InvalidateProgram();
 			return static_cast<T*>(m_BlendTree.back().get());
 		}
 
@@ -51,6 +59,10 @@ namespace Animix
 
 		bool SetOutputNode(BlendNodeID index);
 
+		// The tree is compiled into a program on the first tick after its structure changes
+		inline void InvalidateProgram() { m_ProgramDirty = true; }
+		inline const BlendProgram& GetProgram() const { return m_Program; }
+
 	private:
 		inline BlendNode* Root() const { return m_BlendTree.at(m_OutputNode).get(); }
 
@@ -61,6 +73,10 @@ namespace Animix
 		// Which node in the tree should be used for output
 		size_t m_OutputNode = 0;
 
+		// The flattened tree, which is evaluated instead of walking the nodes
+		mutable BlendProgram m_Program;
+		mutable bool m_ProgramDirty = true;
+
 		// The global clock timestamp at which that this state began
 		float m_StartTime = 0.0f;
 	};
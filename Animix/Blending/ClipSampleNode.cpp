@@ -20,18 +20,22 @@ namespace Animix
 		return m_Clip != nullptr;
 	}
 
-	void ClipSampleNode::Tick(float timeScale)
+	void ClipSampleNode::Tick(float deltaTime, float timeScale)
 	{
-		m_Sampler.Tick(timeScale);
+		m_Sampler.Tick(deltaTime, timeScale);
 	}
 
-	SkeletonPose ClipSampleNode::Evaluate() const
+	void ClipSampleNode::Evaluate(SkeletonPose& outPose) const
 	{
-		// Get local time of this clip
-		SkeletonPose pose(m_Clip->GetTarget());
+		ANIMIX_PROFILE_SCOPE_DETAIL("ClipSampleNode::Evaluate", m_ClipID, static_cast<uint32_t>(m_TreeIndex));
+		m_Sampler.SampleLocalPose(outPose);
+	}
 
-		m_Clip->BuildLocalPose(m_Sampler.GetCurrentSampleTime(), pose);
-		return pose;
+	void ClipSampleNode::Compile(BlendProgram& program, BlendSlot out) const
+	{
+		program.BeginNode(*this, "ClipSampleNode::Evaluate", m_ClipID);
+		program.EmitSampleClip(m_Sampler, out);
+		program.EndNode();
 	}
 
 	float ClipSampleNode::CalculateDuration() const
@@ -70,6 +74,7 @@ namespace Animix
 	bool ClipSampleNode::SetClip(const std::string& animName)
 	{
 		m_Clip = g_AnimixEngine->GetAnimationClip(animName);
+		m_ClipID = HashName(animName);
 		m_Sampler.SetClip(m_Clip);
 		return m_Clip;
 	}
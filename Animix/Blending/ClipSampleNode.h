@@ -2,6 +2,7 @@
 
 #include "BlendNode.h"
 #include "../ClipSampler.h"
+#include "../NameID.h"
 
 
 namespace Animix
@@ -23,8 +24,10 @@ namespace Animix
 
 		// Implement BlendNode interface
 		virtual bool IsValid() const override;
-		virtual void Tick(float timeScale) override;
-		virtual SkeletonPose Evaluate() const override;
+		virtual void Tick(float deltaTime, float timeScale) override;
+		virtual void Evaluate(SkeletonPose& outPose) const override;
+		inline virtual bool HasChanged() const override { return m_Sampler.HasSampleTimeChanged(); }
+		virtual void Compile(BlendProgram& program, BlendSlot out) const override;
 
 		virtual float CalculateDuration() const override;
 		virtual bool IsLooping() const override;
@@ -56,6 +59,7 @@ namespace Animix
 
 		// The clip that will be sampled by this node
 		const AnimationClip* m_Clip = nullptr;
+		NameID m_ClipID = 0;
 		ClipSampler m_Sampler;
 	};
 }
@@ -3,6 +3,7 @@
 #include <algorithm>
 
 #include "BlendTree.h"
+#include "Animix/AnimationEngine.h"
 
 
 namespace Animix
@@ -47,7 +48,7 @@ namespace Animix
 		return true;
 	}
 
-	void GeneralLinearBlendNode::Tick(float timeScale)
+	void GeneralLinearBlendNode::Tick(float deltaTime, float timeScale)
 	{
 		float in0_scale = 1.0f;
 		float in1_scale = 1.0f;
@@ -64,8 +65,8 @@ namespace Animix
 			in1_scale = targetDuration / dur0;
 		}
 
-		GetInputNode(m_CurrentInA)->Tick(in0_scale * timeScale);
-		GetInputNode(m_CurrentInB)->Tick(in1_scale * timeScale);
+		GetInputNode(m_CurrentInA)->Tick(deltaTime, in0_scale * timeScale);
+		GetInputNode(m_CurrentInB)->Tick(deltaTime, in1_scale * timeScale);
 
 		// Tick the rest of the inputs to keep them in sync
 		for (size_t input = 0; input < m_Inputs.size(); input++)
@@ -87,17 +88,56 @@ namespace Animix
 				scale = it->Alpha > m_Alpha ? in0_scale : in1_scale;
 			}
 
-			GetInputNode(input)->Tick(scale * timeScale);
+			GetInputNode(input)->Tick(deltaTime, scale * timeScale);
 		}
 	}
 
-	SkeletonPose GeneralLinearBlendNode::Evaluate() const
+	void GeneralLinearBlendNode::Evaluate(SkeletonPose& outPose) const
 	{
+		ANIMIX_PROFILE_SCOPE_DETAIL("GeneralLinearBlendNode::Evaluate", 0, static_cast<uint32_t>(m_TreeIndex));
+
+		// Alpha often sits on one of the inputs, or beyond the ends, where only one input contributes
+		if (m_MappedAlpha == 0.0f || m_MappedAlpha == 1.0f)
+		{
+			GetInputNode(m_MappedAlpha == 0.0f ? m_CurrentInA : m_CurrentInB)->Evaluate(outPose);
+			return;
+		}
+
 		// Perform blending
-		const SkeletonPose pose1(GetInputNode(m_CurrentInA)->Evaluate());
-		const SkeletonPose pose2(GetInputNode(m_CurrentInB)->Evaluate());
+		const ScopedPose pose2(g_AnimixEngine->GetFrameArena().GetPosePool(), outPose);
+		GetInputNode(m_CurrentInA)->Evaluate(outPose);
+		GetInputNode(m_CurrentInB)->Evaluate(pose2.Get());
+
+		SkeletonPose::Lerp(outPose, pose2.Get(), m_MappedAlpha, outPose);
+	}
+
+	void GeneralLinearBlendNode::Compile(BlendProgram& program, BlendSlot out) const
+	{
+		program.BeginNode(*this, "GeneralLinearBlendNode::Evaluate");
 
-		return SkeletonPose::Lerp(pose1, pose2, m_MappedAlpha);
+		// The inputs being blended change with alpha, so every input is compiled into its own slot
+		// and only the two currently in use are evaluated
+		const BlendSlot first = program.AcquireSlots(m_Inputs.size());
+		for (size_t input = 0; input < m_Inputs.size(); input++)
+		{
+			const size_t skip = program.BeginSelectedInput(&m_CurrentInA, &m_CurrentInB, &m_MappedAlpha, input);
+			program.CompileInput(m_Inputs[input], static_cast<BlendSlot>(first + input));
+			program.EndSkip(skip);
+		}
+
+		program.EmitBlendSelected(first, &m_CurrentInA, &m_CurrentInB, &m_MappedAlpha, out);
+		program.ReleaseSlots(m_Inputs.size());
+		program.EndNode();
+	}
+
+	float GeneralLinearBlendNode::GetInputWeight(size_t inputIndex) const
+	{
+		float weight = 0.0f;
+		if (inputIndex == m_CurrentInA)
+			weight += 1.0f - m_MappedAlpha;
+		if (inputIndex == m_CurrentInB)
+			weight += m_MappedAlpha;
+		return weight;
 	}
 
 	float GeneralLinearBlendNode::CalculateDuration() const
@@ -141,6 +181,7 @@ namespace Animix
 			m_Inputs.push_back(inputNode);
 		else
 			m_Inputs[inputIndex] = inputNode;
+		m_Tree->InvalidateProgram();
 
 		return true;
 	}
@@ -28,8 +28,10 @@ namespace Animix
 
 		// Implement BlendNode interface
 		virtual bool IsValid() const override;
-		virtual void Tick(float timeScale) override;
-		virtual SkeletonPose Evaluate() const override;
+		virtual void Tick(float deltaTime, float timeScale) override;
+		virtual void Evaluate(SkeletonPose& outPose) const override;
+		virtual void Compile(BlendProgram& program, BlendSlot out) const override;
+		virtual float GetInputWeight(size_t inputIndex) const override;
 
 		virtual float CalculateDuration() const override;
 		virtual bool IsLooping() const override;
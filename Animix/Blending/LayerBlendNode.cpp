@@ -0,0 +1,103 @@
+#include "LayerBlendNode.h"
+
+#include "BlendTree.h"
+#include "Animix/AnimationEngine.h"
+
+
+namespace Animix
+{
+
+	LayerBlendNode::LayerBlendNode(BlendTree* tree, size_t index)
+		: BlendNode(tree, index)
+	{
+		// This node has a base input and an overlay input
+		m_Inputs.resize(2, -1);
+	}
+
+	bool LayerBlendNode::IsValid() const
+	{
+		// Validate parameters
+		if (m_Mask.Weights.empty())
+			return false;
+
+		// Validate children
+		if (!(m_Tree->DoesNodeExist(m_Inputs.at(0))
+			&& m_Tree->DoesNodeExist(m_Inputs.at(1))))
+			return false;
+
+		return GetInputNode(0)->IsValid() && GetInputNode(1)->IsValid();
+	}
+
+	void LayerBlendNode::Tick(float deltaTime, float timeScale)
+	{
+		// The overlay keeps its own timing, rather than being scaled to match the base
+		GetInputNode(0)->Tick(deltaTime, timeScale);
+		GetInputNode(1)->Tick(deltaTime, timeScale);
+	}
+
+	void LayerBlendNode::Evaluate(SkeletonPose& outPose) const
+	{
+		ANIMIX_PROFILE_SCOPE_DETAIL("LayerBlendNode::Evaluate", 0, static_cast<uint32_t>(m_TreeIndex));
+
+		GetInputNode(0)->Evaluate(outPose);
+		if (m_Weight == 0.0f || m_Mask.Joints.empty())
+			return;
+
+		// The overlay only needs the masked joints, so everything below this node skips the rest of the skeleton
+		const ScopedPose overlay(g_AnimixEngine->GetFrameArena().GetPosePool(), outPose.SkID);
+		overlay.Get().Mask = &m_Mask;
+		GetInputNode(1)->Evaluate(overlay.Get());
+		SkeletonPose::Layer(outPose, overlay.Get(), m_Mask, m_Weight, outPose);
+	}
+
+	void LayerBlendNode::Compile(BlendProgram& program, BlendSlot out) const
+	{
+		program.BeginNode(*this, "LayerBlendNode::Evaluate");
+		const BlendSlot overlay = program.AcquireSlots();
+		program.CompileInput(m_Inputs[0], out);
+
+		const size_t skip = program.BeginSkipIfWeight(&m_Weight, 0.0f);
+		program.BeginJointMask(m_Mask, overlay);
+		program.CompileInput(m_Inputs[1], overlay);
+		program.EmitLayer(out, overlay, m_Mask, &m_Weight, out);
+		program.EndJointMask();
+		program.EndSkip(skip);
+
+		program.ReleaseSlots();
+		program.EndNode();
+	}
+
+	float LayerBlendNode::GetInputWeight(size_t inputIndex) const
+	{
+		if (inputIndex == 0)
+			return 1.0f;
+		return m_Mask.Joints.empty() ? 0.0f : m_Weight;
+	}
+
+	float LayerBlendNode::CalculateDuration() const
+	{
+		return GetInputNode(0)->CalculateDuration();
+	}
+
+	bool LayerBlendNode::IsLooping() const
+	{
+		return GetInputNode(0)->IsLooping();
+	}
+
+	bool LayerBlendNode::HasVariableWithName(const std::string& name)
+	{
+		if (name == "weight")
+			return true;
+
+		return false;
+	}
+
+	ParameterObserver LayerBlendNode::GetObserverForVariable(const std::string& name)
+	{
+		if (name == "weight")
+			return GetParamObserver_Weight();
+
+		return {};
+	}
+
+}
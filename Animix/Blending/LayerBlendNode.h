@@ -0,0 +1,63 @@
+#pragma once
+
+#include "BlendNode.h"
+
+
+namespace Animix
+{
+	/**
+	 * Blends an overlay input over a base input with a weight for each joint, such as an upper body action over locomotion.
+	 * Input 0 is the base, and input 1 the overlay; the overlay only samples and blends the joints in the mask
+	 */
+	class LayerBlendNode : public BlendNode
+	{
+	public:
+		LayerBlendNode(BlendTree* tree, size_t index);
+		~LayerBlendNode() override = default;
+
+		// Disallow copying
+		LayerBlendNode(const LayerBlendNode&) = delete;
+		LayerBlendNode& operator=(const LayerBlendNode&) = delete;
+
+		// Default moving
+		LayerBlendNode(LayerBlendNode&&) = default;
+		LayerBlendNode& operator=(LayerBlendNode&&) = default;
+
+
+		// Implement BlendNode interface
+		virtual bool IsValid() const override;
+		virtual void Tick(float deltaTime, float timeScale) override;
+		virtual void Evaluate(SkeletonPose& outPose) const override;
+		virtual void Compile(BlendProgram& program, BlendSlot out) const override;
+		virtual float GetInputWeight(size_t inputIndex) const override;
+
+		// The overlay does not change the timing of the base
+		virtual float CalculateDuration() const override;
+		virtual bool IsLooping() const override;
+
+		virtual bool HasVariableWithName(const std::string& name) override;
+		virtual ParameterObserver GetObserverForVariable(const std::string& name) override;
+
+		// Methods for this type of node
+
+		// These setters are to be used on construction of the blend tree
+		// After tree construction, the node will be buried within the tree and difficult to access
+		// During game play, the parameter table and observer system should be used to manipulate node properties
+		inline void SetWeight(float weight) { m_Weight = weight; }
+		inline void SetMask(JointMask&& mask) { m_Mask = std::move(mask); }
+		inline const JointMask& GetMask() const { return m_Mask; }
+
+		// Getters for observers for node parameters
+		inline ParameterObserver GetParamObserver_Weight()
+		{
+			return[this](float weight) { this->m_Weight = weight; };
+		}
+
+	protected:
+		// Additional parameters required by this node
+
+		// Scales the weight of every joint in the mask
+		float m_Weight = 1.0f;
+		JointMask m_Mask;
+	};
+}
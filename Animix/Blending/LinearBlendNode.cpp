@@ -1,6 +1,7 @@
 #include "LinearBlendNode.h"
 
 #include "BlendTree.h"
+#include "Animix/AnimationEngine.h"
 
 
 namespace Animix
@@ -36,7 +37,7 @@ namespace Animix
 		return true;
 	}
 
-	void LinearBlendNode::Tick(float timeScale)
+	void LinearBlendNode::Tick(float deltaTime, float timeScale)
 	{
 		float in0_scale = 1.0f;
 		float in1_scale = 1.0f;
@@ -52,17 +53,46 @@ namespace Animix
 			in1_scale = targetDuration / dur0;
 		}
 
-		GetInputNode(0)->Tick(in0_scale * timeScale);
-		GetInputNode(1)->Tick(in1_scale * timeScale);
+		GetInputNode(0)->Tick(deltaTime, in0_scale * timeScale);
+		GetInputNode(1)->Tick(deltaTime, in1_scale * timeScale);
 	}
 
-	SkeletonPose LinearBlendNode::Evaluate() const
+	void LinearBlendNode::Evaluate(SkeletonPose& outPose) const
 	{
+		ANIMIX_PROFILE_SCOPE_DETAIL("LinearBlendNode::Evaluate", 0, static_cast<uint32_t>(m_TreeIndex));
+
+		// At either end, only one input contributes
+		if (m_Alpha == 0.0f || m_Alpha == 1.0f)
+		{
+			GetInputNode(m_Alpha == 0.0f ? 0 : 1)->Evaluate(outPose);
+			return;
+		}
+
 		// Perform blending
-		const SkeletonPose pose1(GetInputNode(0)->Evaluate());
-		const SkeletonPose pose2(GetInputNode(1)->Evaluate());
+		const ScopedPose pose2(g_AnimixEngine->GetFrameArena().GetPosePool(), outPose);
+		GetInputNode(0)->Evaluate(outPose);
+		GetInputNode(1)->Evaluate(pose2.Get());
+
+		SkeletonPose::Lerp(outPose, pose2.Get(), m_Alpha, outPose);
+	}
+
+	void LinearBlendNode::Compile(BlendProgram& program, BlendSlot out) const
+	{
+		program.BeginNode(*this, "LinearBlendNode::Evaluate");
+		const BlendSlot pose2 = program.AcquireSlots();
+
+		const size_t skip0 = program.BeginSkipIfWeight(&m_Alpha, 1.0f);
+		program.CompileInput(m_Inputs[0], out);
+		program.EndSkip(skip0);
+
+		const size_t skip1 = program.BeginSkipIfWeight(&m_Alpha, 0.0f);
+		program.CompileInput(m_Inputs[1], pose2);
+		program.EndSkip(skip1);
 
-		return SkeletonPose::Lerp(pose1, pose2, m_Alpha);
+		// Copies pose2 if alpha is 1, and leaves out alone if it is 0
+		program.EmitBlend(out, pose2, &m_Alpha, out);
+		program.ReleaseSlots();
+		program.EndNode();
 	}
 
 	float LinearBlendNode::CalculateDuration() const
@@ -31,40 +31,48 @@ namespace Animix
 	void ParameterTable::Clear()
 	{
 		m_Parameters.clear();
+		m_Version++;
 	}
 
 	
 	void ParameterTable::CreateParam(const std::string& paramName, float defaultValue)
 	{
-		if (m_Parameters.find(paramName) == m_Parameters.end())
+		const NameID id = InternName(paramName);
+		if (m_Parameters.find(id) == m_Parameters.end())
 		{
-			m_Parameters.insert({ paramName, std::make_unique<AnimationParameter>(paramName, defaultValue) });
+			m_Parameters.insert({ id, std::make_unique<AnimationParameter>(paramName, defaultValue) });
+			m_Version++;
 		}
 	}
 
-	void ParameterTable::AddParamObserver(const std::string& paramName, ParameterObserver&& observer) const
+	void ParameterTable::AddParamObserver(NameID paramID, ParameterObserver&& observer) const
 	{
-		m_Parameters.at(paramName)->AddObserver(std::move(observer));
+		m_Parameters.at(paramID)->AddObserver(std::move(observer));
+		m_Version++;
 	}
 
-	void ParameterTable::SetParam(const std::string& paramName, float value) const
+	void ParameterTable::SetParam(NameID paramID, float value) const
 	{
-		m_Parameters.at(paramName)->SetValue(value);
+		AnimationParameter& param = *m_Parameters.at(paramID);
+		if (param.GetValue() != value)
+			m_Version++;
+		param.SetValue(value);
 	}
 
-	bool ParameterTable::ParameterExists(const std::string& paramName) const
+	bool ParameterTable::ParameterExists(NameID paramID) const
 	{
-		return m_Parameters.find(paramName) != m_Parameters.end();
+		return m_Parameters.find(paramID) != m_Parameters.end();
 	}
 
-	float ParameterTable::GetParameter(const std::string& paramName) const
+	float ParameterTable::GetParameter(NameID paramID) const
 	{
-		return m_Parameters.at(paramName)->GetValue();
+		return m_Parameters.at(paramID)->GetValue();
 	}
 
 	void ParameterTable::UpdateAllParameters() const
 	{
 		for (const auto& param : m_Parameters)
 			param.second->UpdateObservers();
+		m_Version++;
 	}
 }
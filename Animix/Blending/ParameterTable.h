@@ -5,6 +5,7 @@
 #include <unordered_map>
 
 #include "../AnimixTypes.h"
+#include "../NameID.h"
 
 
 namespace Animix
@@ -45,21 +46,29 @@ namespace Animix
 		void Clear();
 
 		void CreateParam(const std::string& paramName, float defaultValue);
-		void AddParamObserver(const std::string& paramName, ParameterObserver&& observer) const;
+		void AddParamObserver(NameID paramID, ParameterObserver&& observer) const;
+		inline void AddParamObserver(const std::string& paramName, ParameterObserver&& observer) const { AddParamObserver(HashName(paramName), std::move(observer)); }
 
 		// Will call any relevant observers of this parameter
-		void SetParam(const std::string& paramName, float value) const;
+		void SetParam(NameID paramID, float value) const;
+		inline void SetParam(const std::string& paramName, float value) const { SetParam(HashName(paramName), value); }
 
-		bool ParameterExists(const std::string& paramName) const;
-		float GetParameter(const std::string& paramName) const;
+		bool ParameterExists(NameID paramID) const;
+		inline bool ParameterExists(const std::string& paramName) const { return ParameterExists(HashName(paramName)); }
+		float GetParameter(NameID paramID) const;
+		inline float GetParameter(const std::string& paramName) const { return GetParameter(HashName(paramName)); }
 
 
 		// In some cases it may be required to fire all observers to ensure they have the most up to date
 		// value of all parameters
 		void UpdateAllParameters() const;
 
+		// Incremented whenever the value of any parameter changes, so that users can cheaply tell if anything changed
+		inline uint64_t GetVersion() const { return m_Version; }
+
 	private:
 		// Table of parameter values
-		std::unordered_map<std::string, std::unique_ptr<AnimationParameter>> m_Parameters;
+		std::unordered_map<NameID, std::unique_ptr<AnimationParameter>> m_Parameters;
+		mutable uint64_t m_Version = 0;
 	};
 }
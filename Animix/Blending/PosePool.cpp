@@ -0,0 +1,54 @@
+#include "PosePool.h"
+
+#include <cassert>
+
+#include "Animix/AnimationEngine.h"
+
+
+namespace Animix
+{
+	SkeletonPose& PosePool::Acquire(SkeletonID skeleton)
+	{
+		if (m_InUse == m_Poses.size())
+		{
+			// Grow the pool; this only happens the first few times a tree is evaluated
+			m_Poses.emplace_back(std::make_unique<SkeletonPose>(skeleton));
+		}
+		else if (m_Poses[m_InUse]->SkID != skeleton)
+		{
+			// Once the pose has held the largest skeleton this does not allocate
+			SkeletonPose& pose = *m_Poses[m_InUse];
+			const size_t jointCount = g_AnimixEngine->GetSkeleton(skeleton)->Joints.size();
+			pose.SkID = skeleton;
+			pose.LocalPose.resize(jointCount);
+			pose.GlobalPose.resize(jointCount);
+		}
+
+		SkeletonPose& pose = *m_Poses[m_InUse++];
+		pose.Mask = nullptr;
+		return pose;
+	}
+
+	void PosePool::Release()
+	{
+		assert(m_InUse > 0);
+		m_InUse--;
+	}
+
+	void PosePool::GrowToMatch(const PosePool& other)
+	{
+		assert(m_InUse == 0);
+
+		for (size_t index = 0; index < other.m_Poses.size(); index++)
+		{
+			const SkeletonPose& otherPose = *other.m_Poses[index];
+			if (index == m_Poses.size())
+				m_Poses.emplace_back(std::make_unique<SkeletonPose>(otherPose.SkID));
+
+			// Leave room for the largest skeleton the other pose has held, so that switching skeletons does not allocate
+			SkeletonPose& pose = *m_Poses[index];
+			pose.LocalPose.reserve(otherPose.LocalPose.capacity());
+			pose.GlobalPose.reserve(otherPose.GlobalPose.capacity());
+		}
+	}
+}
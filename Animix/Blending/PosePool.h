@@ -0,0 +1,81 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../Skeleton.h"
+
+
+namespace Animix
+{
+	/**
+	 * Scratch poses for blend nodes to evaluate their inputs into.
+	 * Poses are handed out and returned in stack order, which matches the depth-first order that blend trees are evaluated in.
+	 * Poses are never freed, so once the pool has grown to fit the deepest tree no more allocations are made.
+	 * A pose may be handed out for a different skeleton than it was last used for, in which case it is resized in place
+	 */
+	class PosePool
+	{
+	public:
+		PosePool() = default;
+		~PosePool() = default;
+
+		// Disallow copying
+		PosePool(const PosePool&) = delete;
+		PosePool& operator=(const PosePool&) = delete;
+
+		// Default moving
+		PosePool(PosePool&&) = default;
+		PosePool& operator=(PosePool&&) = default;
+
+
+		// The contents of the pose are undefined, and it has no joint mask
+		SkeletonPose& Acquire(SkeletonID skeleton);
+		// Returns the most recently acquired pose
+		void Release();
+
+		// Grow to hold at least the poses of another pool, sized for the same skeletons
+		// No poses may be in use
+		void GrowToMatch(const PosePool& other);
+
+		inline size_t GetPoolSize() const { return m_Poses.size(); }
+		inline size_t GetInUseCount() const { return m_InUse; }
+
+	private:
+		// Poses are held by pointer so that references remain valid as the pool grows
+		std::vector<std::unique_ptr<SkeletonPose>> m_Poses;
+		size_t m_InUse = 0;
+	};
+
+	/**
+	 * Acquires a pose from a pool for the lifetime of this object
+	 */
+	class ScopedPose
+	{
+	public:
+		ScopedPose(PosePool& pool, SkeletonID skeleton)
+			: m_Pool(pool)
+			, m_Pose(pool.Acquire(skeleton))
+		{}
+		// A pose for the same skeleton and joint mask as like, for the inputs of a node evaluating into like
+		ScopedPose(PosePool& pool, const SkeletonPose& like)
+			: m_Pool(pool)
+			, m_Pose(pool.Acquire(like.SkID))
+		{
+			m_Pose.Mask = like.Mask;
+		}
+		~ScopedPose() { m_Pool.Release(); }
+
+		// Disallow copying and moving
+		ScopedPose(const ScopedPose&) = delete;
+		ScopedPose& operator=(const ScopedPose&) = delete;
+		ScopedPose(ScopedPose&&) = delete;
+		ScopedPose& operator=(ScopedPose&&) = delete;
+
+		inline SkeletonPose& Get() const { return m_Pose; }
+
+	private:
+		PosePool& m_Pool;
+		SkeletonPose& m_Pose;
+	};
+}
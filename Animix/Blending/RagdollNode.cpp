@@ -1,5 +1,6 @@
 #include "RagdollNode.h"
 
+#include "Animix/AnimationEngine.h"
 #include "Animix/AniPhysix/Ragdoll.h"
 
 
@@ -16,16 +17,16 @@ namespace Animix
 		return m_Ragdoll != nullptr;
 	}
 
-	void RagdollNode::Tick(float timeScale)
+	void RagdollNode::Tick(float deltaTime, float timeScale)
 	{
 		m_Ragdoll->SetDirty(true);
 	}
 
-	SkeletonPose RagdollNode::Evaluate() const
+	void RagdollNode::Evaluate(SkeletonPose& outPose) const
 	{
-		SkeletonPose pose = m_Ragdoll->CreatePoseFromSimulation();
-		pose.RecoverLocalPoseFromGlobal();
-		return pose;
+		ANIMIX_PROFILE_SCOPE_DETAIL("RagdollNode::Evaluate", 0, static_cast<uint32_t>(m_TreeIndex));
+		m_Ragdoll->CreatePoseFromSimulation(outPose);
+		outPose.RecoverLocalPoseFromGlobal();
 	}
 
 	bool RagdollNode::SetInput(size_t inputIndex, BlendNodeID inputNode)
@@ -29,8 +29,10 @@ namespace Animix
 
 		// Implement BlendNode interface
 		virtual bool IsValid() const override;
-		virtual void Tick(float timeScale) override;
-		virtual SkeletonPose Evaluate() const override;
+		virtual void Tick(float deltaTime, float timeScale) override;
+		virtual void Evaluate(SkeletonPose& outPose) const override;
+		// The simulation is always moving
+		inline virtual bool HasChanged() const override { return true; }
 
 		virtual bool SetInput(size_t inputIndex, BlendNodeID inputNode) override;
 
@@ -1,29 +1,52 @@
 #include "ClipSampler.h"
 
+#include <algorithm>
+
 #include "AnimationClip.h"
 #include "AnimationEngine.h"
 
 
 namespace Animix
 {
+	namespace
+	{
+		float ClampSampleTime(const AnimationClip* clip, float time)
+		{
+			return std::min(std::max(time, 0.0f), clip->GetDuration());
+		}
+	}
+
+
 	ClipSampler::ClipSampler(const AnimationClip* clip)
 		: m_Clip(clip)
 	{
 	}
 
+	void ClipSampler::SetClip(const AnimationClip* clip)
+	{
+		m_Clip = clip;
+
+		// Cursors are only meaningful for the clip they were created for
+		m_KeyCursors.PositionCursors.clear();
+		m_KeyCursors.RotationCursors.clear();
+		m_LastSampledTime = -1.0f;
+	}
+
 	void ClipSampler::PlayFromStart()
 	{
 		m_LocalTimer = 0.0f;
 	}
 
 
-	void ClipSampler::Tick(float timeScale)
+	void ClipSampler::Tick(float deltaTime, float timeScale)
 	{
 		// Perform tick
+		// A sampler may be reachable through more than one path in a tree, but should only advance once per engine tick
+		// The tick index is only written by the engine before any animators are updated, so is safe to read from any thread
 		if (m_LastTickIndex != g_AnimixEngine->GetTickIndex())
 		{
 			const float netScale = m_PlaybackSpeed * timeScale;
-			m_LocalTimer += g_AnimixEngine->GetDeltaTime() * netScale;
+			m_LocalTimer += deltaTime * netScale;
 			m_LastTickIndex = g_AnimixEngine->GetTickIndex();
 		}
 
@@ -40,6 +63,19 @@ namespace Animix
 		return m_LocalTimer;
 	}
 
+	void ClipSampler::SampleLocalPose(SkeletonPose& outPose) const
+	{
+		m_Clip->BuildLocalPose(GetCurrentSampleTime(), outPose, &m_KeyCursors);
+		m_LastSampledTime = ClampSampleTime(m_Clip, GetCurrentSampleTime());
+	}
+
+	bool ClipSampler::HasSampleTimeChanged() const
+	{
+		// Clips hold their first and last frames outside of their duration,
+		// so a non-looping clip that has finished is not changing
+		return ClampSampleTime(m_Clip, GetCurrentSampleTime()) != m_LastSampledTime;
+	}
+
 	float ClipSampler::GetDuration() const
 	{
 		return m_Clip->GetDuration() * m_PlaybackSpeed;
@@ -2,11 +2,11 @@
 
 #include <cstdint>
 
+#include "AnimationClip.h"
+
 
 namespace Animix
 {
-	class AnimationClip;
-
 
 	/*
 	 * A collection of properties and methods to sample and animation clip.
@@ -17,17 +17,22 @@ namespace Animix
 	public:
 		ClipSampler(const AnimationClip* clip);
 
-		void Tick(float timeScale);
+		void Tick(float deltaTime, float timeScale);
 		float GetCurrentSampleTime() const;
 
 		float GetDuration() const;
 
+		// Samples the clip at the current sample time
+		void SampleLocalPose(SkeletonPose& outPose) const;
+		// Would sampling now give a different pose to the last time the clip was sampled
+		bool HasSampleTimeChanged() const;
+
 		// Manipulation operations
 		void PlayFromStart();
 
 		// Getters and setters
 		inline const AnimationClip* GetClip() const { return m_Clip; }
-		inline void SetClip(const AnimationClip* clip) { m_Clip = clip; }
+		void SetClip(const AnimationClip* clip);
 
 		inline float GetPlaybackSpeed() const { return m_PlaybackSpeed; }
 		inline void SetPlaybackSpeed(float playbackSpeed) { m_PlaybackSpeed = playbackSpeed; }
@@ -44,6 +49,12 @@ namespace Animix
 		// The local timer
 		float m_LocalTimer = 0.0f;
 		uint64_t m_LastTickIndex = 0u;
+
+		// Where in the clip this sampler last sampled from
+		// Sampling does not change the state of the sampler, only how quickly it can be sampled next time
+		mutable KeyCursorCache m_KeyCursors;
+		// The time the clip was last sampled at, after clamping to the clip
+		mutable float m_LastSampledTime = -1.0f;
 	};
 
 }
@@ -0,0 +1,72 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+namespace Animix
+{
+	FrameArena::FrameArena(size_t capacity)
+		: m_Buffer(std::make_unique<uint8_t[]>(capacity))
+		, m_Capacity(capacity)
+	{
+	}
+
+
+	void FrameArena::Reset()
+	{
+		assert(m_PosePool.GetInUseCount() == 0 && "Poses are still in use!");
+
+		if (!m_Overflow.empty())
+		{
+			// Grow so that a tick like the last one fits entirely within the buffer
+			m_Overflow.clear();
+			m_Capacity = std::max(m_Capacity * 2, m_HighWaterMark);
+			m_Buffer = std::make_unique<uint8_t[]>(m_Capacity);
+		}
+
+		m_Offset = 0;
+		m_BytesUsed = 0;
+	}
+
+	void FrameArena::GrowToMatch(const FrameArena& other)
+	{
+		assert(m_Offset == 0 && m_Overflow.empty() && "Arenas can only grow when reset!");
+
+		if (other.m_Capacity > m_Capacity)
+		{
+			m_Capacity = other.m_Capacity;
+			m_Buffer = std::make_unique<uint8_t[]>(m_Capacity);
+		}
+
+		m_PosePool.GrowToMatch(other.m_PosePool);
+	}
+
+	void* FrameArena::Allocate(size_t size, size_t alignment)
+	{
+		assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+
+		const uintptr_t base = reinterpret_cast<uintptr_t>(m_Buffer.get());
+		const uintptr_t aligned = (base + m_Offset + alignment - 1) & ~(uintptr_t(alignment) - 1);
+		const size_t end = static_cast<size_t>(aligned - base) + size;
+
+		void* memory;
+		if (end <= m_Capacity)
+		{
+			memory = reinterpret_cast<void*>(aligned);
+			m_BytesUsed += end - m_Offset;
+			m_Offset = end;
+		}
+		else
+		{
+			// Over-allocate so that the block can be aligned
+			m_Overflow.emplace_back(std::make_unique<uint8_t[]>(size + alignment));
+			const uintptr_t block = reinterpret_cast<uintptr_t>(m_Overflow.back().get());
+			memory = reinterpret_cast<void*>((block + alignment - 1) & ~(uintptr_t(alignment) - 1));
+			m_BytesUsed += size + alignment;
+		}
+
+		m_HighWaterMark = std::max(m_HighWaterMark, m_BytesUsed);
+		return memory;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "Blending/PosePool.h"
+
+
+namespace Animix
+{
+	/**
+	 * Storage for data that only lives for the duration of a single engine tick.
+	 * Memory is handed out linearly and is all released at once when the arena is reset at the start of the next tick.
+	 * Each thread that updates animators has its own arena, so allocating never requires synchronisation.
+	 *
+	 * Allocations that do not fit are served from overflow blocks, and the arena grows to the high-water mark on the next reset,
+	 * so after the first few ticks no more memory is allocated
+	 */
+	class FrameArena
+	{
+	public:
+		FrameArena(size_t capacity = 16 * 1024);
+		~FrameArena() = default;
+
+		// Disallow copying
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		// Default moving
+		FrameArena(FrameArena&&) = default;
+		FrameArena& operator=(FrameArena&&) = default;
+
+
+		// Release everything allocated since the last reset
+		// No poses may be in use
+		void Reset();
+		// Grow to at least the capacity and scratch poses of another arena, so that a thread given work for the first time does not allocate
+		// Must be called straight after Reset
+		void GrowToMatch(const FrameArena& other);
+
+		// Memory is uninitialized, and remains valid until the arena is reset
+		void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+		// Everything allocated after a marker can be released early by rewinding to it, for scratch memory that is reused within a tick
+		struct Marker
+		{
+			size_t Offset = 0;
+			size_t BytesUsed = 0;
+		};
+		inline Marker GetMarker() const { return { m_Offset, m_BytesUsed }; }
+		inline void Rewind(const Marker& marker) { m_Offset = marker.Offset; m_BytesUsed = marker.BytesUsed; }
+
+		template<typename T>
+		T* AllocateArray(size_t count)
+		{
+			// Destructors are never run on arena memory
+			static_assert(std::is_trivially_destructible<T>::value, "Arena allocations must be trivially destructible");
+			return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+		}
+
+		// Scratch poses, handed out in stack order
+		inline PosePool& GetPosePool() { return m_PosePool; }
+
+		// Statistics
+		inline size_t GetCapacity() const { return m_Capacity; }
+		inline size_t GetBytesUsed() const { return m_BytesUsed; }
+		inline size_t GetHighWaterMark() const { return m_HighWaterMark; }
+		inline size_t GetPoseHighWaterMark() const { return m_PosePool.GetPoolSize(); }
+
+	private:
+		std::unique_ptr<uint8_t[]> m_Buffer;
+		size_t m_Capacity = 0;
+		size_t m_Offset = 0;
+
+		// Allocations that did not fit into the buffer this tick
+		std::vector<std::unique_ptr<uint8_t[]>> m_Overflow;
+
+		size_t m_BytesUsed = 0;
+		size_t m_HighWaterMark = 0;
+
+		PosePool m_PosePool;
+	};
+}
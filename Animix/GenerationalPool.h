@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+namespace Animix
+{
+	/**
+	 * Refers to an object in a GenerationalPool.
+	 * The generation is incremented whenever an object is destroyed, so handles to destroyed objects can be detected
+	 */
+	template<typename T>
+	struct Handle
+	{
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+		uint32_t Index = INVALID_INDEX;
+		uint32_t Generation = 0;
+
+		inline bool IsValid() const { return Index != INVALID_INDEX; }
+
+		inline bool operator==(const Handle& other) const { return Index == other.Index && Generation == other.Generation; }
+		inline bool operator!=(const Handle& other) const { return !(*this == other); }
+	};
+
+
+	/**
+	 * Owns a collection of objects that are created and destroyed at runtime.
+	 * Objects are allocated in fixed-size pages, so they never move once created and pointers to them remain valid until they are destroyed.
+	 * Destroyed slots are reused through a free list, and a dense array of the living objects allows iterating over them without gaps
+	 */
+	template<typename T, size_t PageSize = 64>
+	class GenerationalPool
+	{
+	public:
+		GenerationalPool() = default;
+		~GenerationalPool() { Clear(); }
+
+		// Disallow copying
+		GenerationalPool(const GenerationalPool&) = delete;
+		GenerationalPool& operator=(const GenerationalPool&) = delete;
+
+		// Moving takes the pages, so the objects themselves do not move
+		GenerationalPool(GenerationalPool&&) = default;
+		GenerationalPool& operator=(GenerationalPool&& other)
+		{
+			if (this == &other)
+				return *this;
+
+			// The objects living in this pool must be destroyed before their pages are released
+			Clear();
+			m_Pages = std::move(other.m_Pages);
+			m_Slots = std::move(other.m_Slots);
+			m_FreeSlots = std::move(other.m_FreeSlots);
+			m_Dense = std::move(other.m_Dense);
+			m_DenseSlots = std::move(other.m_DenseSlots);
+			return *this;
+		}
+
+
+		template<typename... Args>
+		Handle<T> Create(Args&&... args)
+		{
+			uint32_t index;
+			if (!m_FreeSlots.empty())
+			{
+				index = m_FreeSlots.back();
+				m_FreeSlots.pop_back();
+			}
+			else
+			{
+				index = static_cast<uint32_t>(m_Slots.size());
+				if (index % PageSize == 0)
+					m_Pages.emplace_back(new Storage[PageSize]);
+				m_Slots.emplace_back();
+			}
+
+			T* object = new (GetStorage(index)) T(std::forward<Args>(args)...);
+
+			Slot& slot = m_Slots[index];
+			slot.DenseIndex = static_cast<uint32_t>(m_Dense.size());
+			slot.Alive = true;
+			m_Dense.push_back(object);
+			m_DenseSlots.push_back(index);
+
+			return { index, slot.Generation };
+		}
+
+		void Destroy(Handle<T> handle)
+		{
+			T* object = Get(handle);
+			if (!object)
+				return;
+
+			Slot& slot = m_Slots[handle.Index];
+
+			// Fill the gap in the dense array with the last object
+			const uint32_t last = static_cast<uint32_t>(m_Dense.size() - 1);
+			m_Dense[slot.DenseIndex] = m_Dense[last];
+			m_DenseSlots[slot.DenseIndex] = m_DenseSlots[last];
+			m_Slots[m_DenseSlots[slot.DenseIndex]].DenseIndex = slot.DenseIndex;
+			m_Dense.pop_back();
+			m_DenseSlots.pop_back();
+
+			object->~T();
+
+			// Invalidate any remaining handles to this slot
+			slot.Alive = false;
+			slot.Generation++;
+			m_FreeSlots.push_back(handle.Index);
+		}
+
+		void Clear()
+		{
+			for (T* object : m_Dense)
+				object->~T();
+
+			m_Dense.clear();
+			m_DenseSlots.clear();
+			m_Slots.clear();
+			m_FreeSlots.clear();
+			m_Pages.clear();
+		}
+
+		// Returns nullptr if the handle does not refer to a living object
+		T* Get(Handle<T> handle) const
+		{
+			if (handle.Index >= m_Slots.size())
+				return nullptr;
+
+			const Slot& slot = m_Slots[handle.Index];
+			if (!slot.Alive || slot.Generation != handle.Generation)
+				return nullptr;
+
+			return m_Dense[slot.DenseIndex];
+		}
+
+		inline bool IsAlive(Handle<T> handle) const { return Get(handle) != nullptr; }
+
+		// Dense iteration over all living objects, in no particular order
+		inline size_t Size() const { return m_Dense.size(); }
+		inline T& operator[](size_t denseIndex) const { assert(denseIndex < m_Dense.size()); return *m_Dense[denseIndex]; }
+
+	private:
+		struct alignas(T) Storage
+		{
+			unsigned char Bytes[sizeof(T)];
+		};
+
+		struct Slot
+		{
+			uint32_t Generation = 0;
+			uint32_t DenseIndex = 0;
+			bool Alive = false;
+		};
+
+		inline void* GetStorage(uint32_t index) { return m_Pages[index / PageSize][index % PageSize].Bytes; }
+
+	private:
+		std::vector<std::unique_ptr<Storage[]>> m_Pages;
+		std::vector<Slot> m_Slots;
+		std::vector<uint32_t> m_FreeSlots;
+
+		// Living objects, packed together for iteration
+		std::vector<T*> m_Dense;
+		std::vector<uint32_t> m_DenseSlots;		// The slot of each object in the dense array
+	};
+}
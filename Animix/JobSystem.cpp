@@ -0,0 +1,169 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+namespace Animix
+{
+	namespace
+	{
+		thread_local size_t s_ThreadIndex = 0;
+	}
+
+
+	void JobSystem::JobQueue::PushBack(const Job& job)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_Count == m_Jobs.size())
+		{
+			// Grow the ring buffer, unwrapping the existing jobs to the start
+			std::vector<Job> jobs(std::max<size_t>(16, m_Jobs.size() * 2));
+			for (size_t i = 0; i < m_Count; i++)
+				jobs[i] = m_Jobs[(m_Front + i) % m_Jobs.size()];
+
+			m_Jobs = std::move(jobs);
+			m_Front = 0;
+		}
+
+		m_Jobs[(m_Front + m_Count) % m_Jobs.size()] = job;
+		m_Count++;
+	}
+
+	bool JobSystem::JobQueue::PopBack(Job& outJob)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Count == 0)
+			return false;
+
+		m_Count--;
+		outJob = m_Jobs[(m_Front + m_Count) % m_Jobs.size()];
+		return true;
+	}
+
+	bool JobSystem::JobQueue::StealFront(Job& outJob)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Count == 0)
+			return false;
+
+		outJob = m_Jobs[m_Front];
+		m_Front = (m_Front + 1) % m_Jobs.size();
+		m_Count--;
+		return true;
+	}
+
+
+	JobSystem::JobSystem(uint32_t workerCount)
+	{
+		m_Queues.resize(workerCount + 1);
+		for (auto& queue : m_Queues)
+			queue = std::make_unique<JobQueue>();
+
+		m_Workers.reserve(workerCount);
+		for (uint32_t worker = 0; worker < workerCount; worker++)
+			m_Workers.emplace_back(&JobSystem::WorkerMain, this, worker + 1);
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_WakeMutex);
+			m_Quit = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (auto& worker : m_Workers)
+			worker.join();
+	}
+
+
+	void JobSystem::ParallelFor(size_t count, size_t batchSize, const ParallelForFunc& func)
+	{
+		assert(m_RemainingJobs == 0 && "ParallelFor cannot be nested");
+		batchSize = std::max<size_t>(batchSize, 1);
+
+		if (m_Workers.empty() || count <= batchSize)
+		{
+			// Not worth waking any workers
+			for (size_t i = 0; i < count; i++)
+				func(i);
+			return;
+		}
+
+		const size_t jobCount = (count + batchSize - 1) / batchSize;
+		m_RemainingJobs = jobCount;
+
+		// Count the jobs before queueing them, so the count can never drop below zero as jobs are taken
+		{
+			std::lock_guard<std::mutex> lock(m_WakeMutex);
+			m_QueuedJobs += jobCount;
+		}
+
+		// Deal the jobs out between all queues, so that every thread has work before it needs to steal
+		for (size_t job = 0; job < jobCount; job++)
+		{
+			const size_t begin = job * batchSize;
+			m_Queues[job % m_Queues.size()]->PushBack({ &func, begin, std::min(begin + batchSize, count) });
+		}
+		m_WakeCondition.notify_all();
+
+		// Help out until every job is complete
+		while (m_RemainingJobs.load(std::memory_order_acquire) > 0)
+		{
+			Job job;
+			if (TryGetJob(0, job))
+				ExecuteJob(job);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+
+	size_t JobSystem::GetCurrentThreadIndex()
+	{
+		return s_ThreadIndex;
+	}
+
+
+	void JobSystem::WorkerMain(size_t queueIndex)
+	{
+		s_ThreadIndex = queueIndex;
+
+		while (true)
+		{
+			Job job;
+			if (TryGetJob(queueIndex, job))
+			{
+				ExecuteJob(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_WakeMutex);
+			m_WakeCondition.wait(lock, [this]() { return m_Quit || m_QueuedJobs > 0; });
+			if (m_Quit)
+				return;
+		}
+	}
+
+	bool JobSystem::TryGetJob(size_t queueIndex, Job& outJob)
+	{
+		// Most recently queued work first from our own queue, then the oldest work from everybody else's
+		bool found = m_Queues[queueIndex]->PopBack(outJob);
+		for (size_t i = 1; i < m_Queues.size() && !found; i++)
+			found = m_Queues[(queueIndex + i) % m_Queues.size()]->StealFront(outJob);
+
+		if (found)
+			m_QueuedJobs--;
+		return found;
+	}
+
+	void JobSystem::ExecuteJob(const Job& job)
+	{
+		for (size_t i = job.Begin; i < job.End; i++)
+			(*job.Func)(i);
+
+		m_RemainingJobs.fetch_sub(1, std::memory_order_release);
+	}
+}
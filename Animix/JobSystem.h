@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace Animix
+{
+	/**
+	 * A small pool of worker threads for spreading per-animator work across cores.
+	 * Each thread (including the thread that submits work) owns a queue of jobs.
+	 * Threads take jobs from the back of their own queue, and steal from the front of other threads' queues once theirs is empty
+	 */
+	class JobSystem
+	{
+	public:
+		using ParallelForFunc = std::function<void(size_t)>;
+
+		// A worker count of 0 runs all work on the calling thread
+		JobSystem(uint32_t workerCount);
+		~JobSystem();
+
+		// Disallow copying and moving; workers hold a pointer to the job system
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+		JobSystem(JobSystem&&) = delete;
+		JobSystem& operator=(JobSystem&&) = delete;
+
+
+		// Calls func for every index in [0, count), and returns once every call has completed
+		// Indices are grouped into jobs of batchSize indices
+		// Must only be called from the thread that owns the job system, and not from within a job
+		void ParallelFor(size_t count, size_t batchSize, const ParallelForFunc& func);
+
+		inline uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+		// 0 on the thread that submits work, otherwise 1 + the index of the worker
+		static size_t GetCurrentThreadIndex();
+
+	private:
+		struct Job
+		{
+			const ParallelForFunc* Func = nullptr;
+			size_t Begin = 0;
+			size_t End = 0;
+		};
+
+		/**
+		 * A double-ended queue of jobs, guarded by a lock.
+		 * Storage is a ring buffer that only grows, so queueing jobs does not allocate once it is large enough
+		 */
+		class JobQueue
+		{
+		public:
+			void PushBack(const Job& job);
+			bool PopBack(Job& outJob);
+			bool StealFront(Job& outJob);
+
+		private:
+			std::mutex m_Mutex;
+			std::vector<Job> m_Jobs;
+			size_t m_Front = 0;
+			size_t m_Count = 0;
+		};
+
+		void WorkerMain(size_t queueIndex);
+
+		bool TryGetJob(size_t queueIndex, Job& outJob);
+		void ExecuteJob(const Job& job);
+
+	private:
+		std::vector<std::thread> m_Workers;
+
+		// Queue 0 belongs to the thread that submits work, the remainder to each worker
+		std::vector<std::unique_ptr<JobQueue>> m_Queues;
+
+		// Jobs that have been queued but not yet taken by any thread
+		std::atomic<size_t> m_QueuedJobs{ 0 };
+		// Jobs from the current ParallelFor that have not finished
+		std::atomic<size_t> m_RemainingJobs{ 0 };
+
+		// Idle workers sleep until there is work to do
+		std::mutex m_WakeMutex;
+		std::condition_variable m_WakeCondition;
+		bool m_Quit = false;
+	};
+}
@@ -0,0 +1,115 @@
+#include "KeyReduction.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace Animix
+{
+	namespace
+	{
+		/*
+		 * Removes keys from a track that can be recreated, within tolerance, by interpolating between the keys either side of them
+		 * withinTolerance(start, end, key) should return true if key can be recreated by interpolating from start to end
+		 * (start and end may be the same key, when testing if the track is constant)
+		 * The first and last keys are always kept, unless every key can be recreated from the first key
+		 * Returns the number of keys removed
+		 */
+		template<typename KeyType, typename ToleranceFunc>
+		uint32_t ReduceKeys(std::vector<KeyType>& keys, ToleranceFunc withinTolerance)
+		{
+			if (keys.size() < 2)
+				return 0;
+
+			const size_t originalCount = keys.size();
+
+			// A constant track collapses to a single key
+			bool constant = true;
+			for (size_t key = 1; key < keys.size() && constant; key++)
+				constant = withinTolerance(keys[0], keys[0], keys[key]);
+			if (constant)
+			{
+				keys.resize(1);
+				return static_cast<uint32_t>(originalCount - 1);
+			}
+
+			std::vector<KeyType> reduced;
+			reduced.push_back(keys[0]);
+
+			// Greedily extend each segment for as long as every key it would remove stays within tolerance
+			size_t segmentStart = 0;
+			while (segmentStart < keys.size() - 1)
+			{
+				size_t segmentEnd = segmentStart + 1;
+				for (size_t candidate = segmentEnd + 1; candidate < keys.size(); candidate++)
+				{
+					// Keys sharing a start time cannot be interpolated between
+					if (keys[candidate].StartTime <= keys[segmentStart].StartTime)
+						break;
+
+					bool canRemove = true;
+					for (size_t key = segmentStart + 1; key < candidate && canRemove; key++)
+						canRemove = withinTolerance(keys[segmentStart], keys[candidate], keys[key]);
+
+					if (!canRemove)
+						break;
+					segmentEnd = candidate;
+				}
+
+				reduced.push_back(keys[segmentEnd]);
+				segmentStart = segmentEnd;
+			}
+
+			keys = std::move(reduced);
+			return static_cast<uint32_t>(originalCount - keys.size());
+		}
+
+		// The angle (radians) between two rotations
+		float AngleBetween(const gef::Quaternion& a, const gef::Quaternion& b)
+		{
+			const float lengthA = sqrtf(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w);
+			const float lengthB = sqrtf(b.x * b.x + b.y * b.y + b.z * b.z + b.w * b.w);
+
+			// q and -q represent the same rotation
+			const float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+			const float sign = dot < 0.0f ? -1.0f : 1.0f;
+
+			// Calculated from the distance between the rotations, as acos of their dot product is too imprecise for small angles
+			const float dx = a.x / lengthA - sign * b.x / lengthB;
+			const float dy = a.y / lengthA - sign * b.y / lengthB;
+			const float dz = a.z / lengthA - sign * b.z / lengthB;
+			const float dw = a.w / lengthA - sign * b.w / lengthB;
+			const float distance = sqrtf(dx * dx + dy * dy + dz * dz + dw * dw);
+			return 4.0f * asinf(std::min(0.5f * distance, 1.0f));
+		}
+	}
+
+
+	uint32_t ReducePositionKeys(std::vector<PositionKey>& keys, float tolerance)
+	{
+		return ReduceKeys(keys, [tolerance](const PositionKey& start, const PositionKey& end, const PositionKey& key) -> bool
+			{
+				const float duration = end.StartTime - start.StartTime;
+				const float t = duration > 0.0f ? (key.StartTime - start.StartTime) / duration : 0.0f;
+				const Vector3 interpolated = Vector3::Lerp(start.Value, end.Value, t);
+
+				const float dx = interpolated.X - key.Value.X;
+				const float dy = interpolated.Y - key.Value.Y;
+				const float dz = interpolated.Z - key.Value.Z;
+				return dx * dx + dy * dy + dz * dz <= tolerance * tolerance;
+			});
+	}
+
+	uint32_t ReduceRotationKeys(std::vector<RotationKey>& keys, float tolerance)
+	{
+		return ReduceKeys(keys, [tolerance](const RotationKey& start, const RotationKey& end, const RotationKey& key) -> bool
+			{
+				const float duration = end.StartTime - start.StartTime;
+				const float t = duration > 0.0f ? (key.StartTime - start.StartTime) / duration : 0.0f;
+				gef::Quaternion interpolated;
+				interpolated.Slerp(start.Value, end.Value, t);
+
+				return AngleBetween(interpolated, key.Value) <= tolerance;
+			});
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "AnimationClip.h"
+
+
+namespace Animix
+{
+	// Remove keys from a track that can be recreated by interpolating their neighbours; returns the number of keys removed
+	// Position tolerance is a distance in the units of the skeleton, rotation tolerance an angle in radians
+	uint32_t ReducePositionKeys(std::vector<PositionKey>& keys, float tolerance);
+	uint32_t ReduceRotationKeys(std::vector<RotationKey>& keys, float tolerance);
+}
@@ -0,0 +1,42 @@
+#include "NameID.h"
+
+#include <cassert>
+#include <mutex>
+#include <unordered_map>
+
+
+namespace Animix
+{
+	namespace
+	{
+		std::mutex s_InternMutex;
+
+		std::unordered_map<NameID, std::string>& GetInternTable()
+		{
+			static std::unordered_map<NameID, std::string> s_Names;
+			return s_Names;
+		}
+	}
+
+
+	NameID InternName(const std::string& name)
+	{
+		const NameID id = HashName(name);
+
+		std::lock_guard<std::mutex> lock(s_InternMutex);
+		const auto result = GetInternTable().emplace(id, name);
+		assert(result.first->second == name && "Two names have the same ID!");
+		(void)result;
+
+		return id;
+	}
+
+	const std::string& GetInternedName(NameID id)
+	{
+		static const std::string s_Unknown;
+
+		std::lock_guard<std::mutex> lock(s_InternMutex);
+		const auto it = GetInternTable().find(id);
+		return it != GetInternTable().end() ? it->second : s_Unknown;
+	}
+}
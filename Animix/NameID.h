@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace Animix
+{
+	/*
+	 * Clips, parameters, states and transitions are looked up by the hash of their name,
+	 * so that gameplay code can refer to them without hashing or comparing strings every frame.
+	 * IDs of string literals can be calculated at compile time, eg "walkSpeed"_id
+	 */
+	using NameID = uint32_t;
+
+	// 32-bit FNV-1a
+	constexpr NameID HashName(const char* name, size_t length)
+	{
+		NameID hash = 2166136261u;
+		for (size_t i = 0; i < length; i++)
+		{
+			hash ^= static_cast<uint8_t>(name[i]);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	inline NameID HashName(const std::string& name) { return HashName(name.data(), name.size()); }
+
+	constexpr NameID operator""_id(const char* name, size_t length) { return HashName(name, length); }
+
+
+	// Hash a name and remember it, so that the ID can be turned back into a name for debugging
+	// Asserts if two different names have the same ID
+	NameID InternName(const std::string& name);
+	// Returns an empty string for IDs that were never interned
+	const std::string& GetInternedName(NameID id);
+}
@@ -0,0 +1,153 @@
+#include "PoseBatch.h"
+
+#include <cassert>
+#include <cstdint>
+
+#if ANIMIX_SSE
+#include <xmmintrin.h>
+#endif
+
+
+namespace Animix
+{
+	namespace
+	{
+		// One float per lane
+#if ANIMIX_SSE
+		struct Lanes
+		{
+			__m128 V;
+
+			static inline Lanes Splat(float f) { return { _mm_set1_ps(f) }; }
+			static inline Lanes Set(const float* f) { return { _mm_loadu_ps(f) }; }
+			inline void Store(float* f) const { _mm_storeu_ps(f, V); }
+
+			inline Lanes operator+(Lanes b) const { return { _mm_add_ps(V, b.V) }; }
+			inline Lanes operator-(Lanes b) const { return { _mm_sub_ps(V, b.V) }; }
+			inline Lanes operator*(Lanes b) const { return { _mm_mul_ps(V, b.V) }; }
+		};
+#else
+		struct Lanes
+		{
+			float V[POSE_BATCH_WIDTH];
+
+			static inline Lanes Splat(float f) { Lanes l; for (size_t i = 0; i < POSE_BATCH_WIDTH; i++) l.V[i] = f; return l; }
+			static inline Lanes Set(const float* f) { Lanes l; for (size_t i = 0; i < POSE_BATCH_WIDTH; i++) l.V[i] = f[i]; return l; }
+			inline void Store(float* f) const { for (size_t i = 0; i < POSE_BATCH_WIDTH; i++) f[i] = V[i]; }
+
+			inline Lanes operator+(Lanes b) const { Lanes l; for (size_t i = 0; i < POSE_BATCH_WIDTH; i++) l.V[i] = V[i] + b.V[i]; return l; }
+			inline Lanes operator-(Lanes b) const { Lanes l; for (size_t i = 0; i < POSE_BATCH_WIDTH; i++) l.V[i] = V[i] - b.V[i]; return l; }
+			inline Lanes operator*(Lanes b) const { Lanes l; for (size_t i = 0; i < POSE_BATCH_WIDTH; i++) l.V[i] = V[i] * b.V[i]; return l; }
+		};
+#endif
+
+		// A rigid transform in the row-vector convention: the 3x3 rotation, then the translation row
+		struct LaneTransform
+		{
+			Lanes R[3][3];
+			Lanes T[3];
+		};
+	}
+
+
+	size_t GetPoseBatchScratchSize(size_t jointCount)
+	{
+		return sizeof(LaneTransform) * jointCount;
+	}
+
+	void BuildMatrixPalettesBatched(const Skeleton& skeleton, const JointTransform* const* localPoses, gef::Matrix44* const* outPalettes, size_t laneCount, void* scratch)
+	{
+		assert(laneCount > 0 && laneCount <= POSE_BATCH_WIDTH);
+		assert(reinterpret_cast<uintptr_t>(scratch) % POSE_BATCH_SCRATCH_ALIGNMENT == 0);
+
+		LaneTransform* globals = static_cast<LaneTransform*>(scratch);
+		const Lanes one = Lanes::Splat(1.0f);
+
+		for (size_t jointIndex = 0; jointIndex < skeleton.Joints.size(); jointIndex++)
+		{
+			const Joint& joint = skeleton.Joints[jointIndex];
+
+			// Gather the local transform of this joint from every instance
+			// Unused lanes repeat the last instance, and are never written out
+			float px[POSE_BATCH_WIDTH], py[POSE_BATCH_WIDTH], pz[POSE_BATCH_WIDTH];
+			float qx[POSE_BATCH_WIDTH], qy[POSE_BATCH_WIDTH], qz[POSE_BATCH_WIDTH], qw[POSE_BATCH_WIDTH];
+			for (size_t lane = 0; lane < POSE_BATCH_WIDTH; lane++)
+			{
+				const JointTransform& local = localPoses[lane < laneCount ? lane : laneCount - 1][jointIndex];
+				px[lane] = local.P.X; py[lane] = local.P.Y; pz[lane] = local.P.Z;
+				qx[lane] = local.Q.x; qy[lane] = local.Q.y; qz[lane] = local.Q.z; qw[lane] = local.Q.w;
+			}
+
+			// Rotation matrix from the quaternion, laid out as gef::Matrix44::Rotation does
+			const Lanes x = Lanes::Set(qx), y = Lanes::Set(qy), z = Lanes::Set(qz), w = Lanes::Set(qw);
+			const Lanes x2 = x + x, y2 = y + y, z2 = z + z;
+			const Lanes xx = x * x2, yy = y * y2, zz = z * z2;
+			const Lanes xy = x * y2, xz = x * z2, yz = y * z2;
+			const Lanes wx = w * x2, wy = w * y2, wz = w * z2;
+
+			LaneTransform local;
+			local.R[0][0] = one - (yy + zz);	local.R[0][1] = xy + wz;			local.R[0][2] = xz - wy;
+			local.R[1][0] = xy - wz;			local.R[1][1] = one - (xx + zz);	local.R[1][2] = yz + wx;
+			local.R[2][0] = xz + wy;			local.R[2][1] = yz - wx;			local.R[2][2] = one - (xx + yy);
+			local.T[0] = Lanes::Set(px);		local.T[1] = Lanes::Set(py);		local.T[2] = Lanes::Set(pz);
+
+			// global = local * parent global
+			LaneTransform& global = globals[jointIndex];
+			if (joint.Parent == -1)
+			{
+				global = local;
+			}
+			else
+			{
+				assert(joint.Parent < static_cast<int32_t>(jointIndex) && "Parents must come before their children");
+				const LaneTransform& parent = globals[joint.Parent];
+
+				for (int row = 0; row < 3; row++)
+				{
+					for (int col = 0; col < 3; col++)
+					{
+						global.R[row][col] = local.R[row][0] * parent.R[0][col]
+							+ local.R[row][1] * parent.R[1][col]
+							+ local.R[row][2] * parent.R[2][col];
+					}
+				}
+				for (int col = 0; col < 3; col++)
+				{
+					global.T[col] = local.T[0] * parent.R[0][col]
+						+ local.T[1] * parent.R[1][col]
+						+ local.T[2] * parent.R[2][col]
+						+ parent.T[col];
+				}
+			}
+
+			// palette = inverse bind pose * global
+			// The inverse bind pose is shared by every instance, and may be any matrix
+			float ib[4][4];
+			for (int row = 0; row < 4; row++)
+			{
+				const gef::Vector4 r = joint.InvBindPose.GetRow(row);
+				ib[row][0] = r.x(); ib[row][1] = r.y(); ib[row][2] = r.z(); ib[row][3] = r.w();
+			}
+
+			float palette[4][3][POSE_BATCH_WIDTH];
+			for (int row = 0; row < 4; row++)
+			{
+				const Lanes a = Lanes::Splat(ib[row][0]), b = Lanes::Splat(ib[row][1]), c = Lanes::Splat(ib[row][2]), d = Lanes::Splat(ib[row][3]);
+				for (int col = 0; col < 3; col++)
+				{
+					const Lanes value = a * global.R[0][col] + b * global.R[1][col] + c * global.R[2][col] + d * global.T[col];
+					value.Store(palette[row][col]);
+				}
+			}
+
+			// Scatter back to each instance
+			// The last column of the global transform is (0, 0, 0, 1), so the last column of the palette is that of the inverse bind pose
+			for (size_t lane = 0; lane < laneCount; lane++)
+			{
+				gef::Matrix44& out = outPalettes[lane][jointIndex];
+				for (int row = 0; row < 4; row++)
+					out.SetRow(row, gef::Vector4(palette[row][0][lane], palette[row][1][lane], palette[row][2][lane], ib[row][3]));
+			}
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+#include "PoseBlend.h"
+#include "Skeleton.h"
+
+
+namespace Animix
+{
+	// How many poses of the same skeleton are processed together, one per SIMD lane
+	constexpr size_t POSE_BATCH_WIDTH = 4;
+
+	// Scratch memory required by BuildMatrixPalettesBatched for a skeleton with jointCount joints
+	constexpr size_t POSE_BATCH_SCRATCH_ALIGNMENT = 16;
+	size_t GetPoseBatchScratchSize(size_t jointCount);
+
+	/**
+	 * Build the global poses and matrix palettes of up to POSE_BATCH_WIDTH instances of the same skeleton at once.
+	 * The hierarchy is walked once for the whole batch, with each instance's transforms in its own SIMD lane.
+	 * Joint transforms are assumed to be rigid (no scale), which is all that local poses can express.
+	 *
+	 * localPoses and outPalettes hold laneCount entries; scratch must hold GetPoseBatchScratchSize bytes and be suitably aligned
+	 */
+	void BuildMatrixPalettesBatched(const Skeleton& skeleton, const JointTransform* const* localPoses, gef::Matrix44* const* outPalettes, size_t laneCount, void* scratch);
+}
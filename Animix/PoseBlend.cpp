@@ -0,0 +1,200 @@
+#include "PoseBlend.h"
+
+#include <cmath>
+#include <cstddef>
+
+#if ANIMIX_SSE
+#include <xmmintrin.h>
+#endif
+
+
+namespace Animix
+{
+	// The SIMD kernel loads quaternions directly from memory
+	static_assert(sizeof(gef::Quaternion) == 4 * sizeof(float), "Quaternion must be tightly packed");
+	static_assert(offsetof(gef::Quaternion, y) == offsetof(gef::Quaternion, x) + sizeof(float)
+		&& offsetof(gef::Quaternion, w) == offsetof(gef::Quaternion, x) + 3 * sizeof(float),
+		"Quaternion components must be stored in the order x, y, z, w");
+
+	namespace
+	{
+		void NLerp(const gef::Quaternion& a, const gef::Quaternion& b, float t, gef::Quaternion& out)
+		{
+			// Negate b if required, so that the blend takes the shortest path
+			const float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+			const float tb = dot < 0.0f ? -t : t;
+			const float ta = 1.0f - t;
+
+			const float x = ta * a.x + tb * b.x;
+			const float y = ta * a.y + tb * b.y;
+			const float z = ta * a.z + tb * b.z;
+			const float w = ta * a.w + tb * b.w;
+
+			const float invLength = 1.0f / sqrtf(x * x + y * y + z * z + w * w);
+			out.x = x * invLength;
+			out.y = y * invLength;
+			out.z = z * invLength;
+			out.w = w * invLength;
+		}
+
+#if ANIMIX_SSE
+		// NLerp 4 joints at a time
+		// Returns the number of joints that were blended; the remainder must be blended by the caller
+		size_t NLerp4(const JointTransform* a, const JointTransform* b, JointTransform* out, size_t count, float t)
+		{
+			const __m128 vt = _mm_set1_ps(t);
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 threeHalves = _mm_set1_ps(1.5f);
+			const __m128 signMask = _mm_set1_ps(-0.0f);
+
+			size_t j = 0;
+			for (; j + 4 <= count; j += 4)
+			{
+				// Load 4 rotations from each pose, and transpose so that each register holds one component of all 4
+				__m128 ax = _mm_loadu_ps(&a[j + 0].Q.x);
+				__m128 ay = _mm_loadu_ps(&a[j + 1].Q.x);
+				__m128 az = _mm_loadu_ps(&a[j + 2].Q.x);
+				__m128 aw = _mm_loadu_ps(&a[j + 3].Q.x);
+				_MM_TRANSPOSE4_PS(ax, ay, az, aw);
+
+				__m128 bx = _mm_loadu_ps(&b[j + 0].Q.x);
+				__m128 by = _mm_loadu_ps(&b[j + 1].Q.x);
+				__m128 bz = _mm_loadu_ps(&b[j + 2].Q.x);
+				__m128 bw = _mm_loadu_ps(&b[j + 3].Q.x);
+				_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+				// Flip the sign of b wherever the dot product is negative, to take the shortest path
+				const __m128 dot = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+					_mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+				const __m128 sign = _mm_and_ps(dot, signMask);
+				bx = _mm_xor_ps(bx, sign);
+				by = _mm_xor_ps(by, sign);
+				bz = _mm_xor_ps(bz, sign);
+				bw = _mm_xor_ps(bw, sign);
+
+				// a + (b - a) * t
+				__m128 x = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(bx, ax), vt));
+				__m128 y = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(by, ay), vt));
+				__m128 z = _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(bz, az), vt));
+				__m128 w = _mm_add_ps(aw, _mm_mul_ps(_mm_sub_ps(bw, aw), vt));
+
+				// Normalize, refining the reciprocal square root estimate with one Newton-Raphson step
+				const __m128 lengthSq = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+					_mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+				__m128 invLength = _mm_rsqrt_ps(lengthSq);
+				invLength = _mm_mul_ps(invLength,
+					_mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, lengthSq), _mm_mul_ps(invLength, invLength))));
+
+				x = _mm_mul_ps(x, invLength);
+				y = _mm_mul_ps(y, invLength);
+				z = _mm_mul_ps(z, invLength);
+				w = _mm_mul_ps(w, invLength);
+
+				// Transpose back and store
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+				_mm_storeu_ps(&out[j + 0].Q.x, x);
+				_mm_storeu_ps(&out[j + 1].Q.x, y);
+				_mm_storeu_ps(&out[j + 2].Q.x, z);
+				_mm_storeu_ps(&out[j + 3].Q.x, w);
+			}
+
+			return j;
+		}
+#endif
+
+		// Hamilton product; rotates by b, then by a
+		inline gef::Quaternion Multiply(const gef::Quaternion& a, const gef::Quaternion& b)
+		{
+			return {
+				a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+				a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+				a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+				a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+			};
+		}
+	}
+
+
+	void BlendJointTransforms(const JointTransform* a, const JointTransform* b, JointTransform* out, size_t count, float t, RotationBlendMode mode)
+	{
+		// Positions are cheap to blend, and the compiler is free to vectorize this loop
+		for (size_t j = 0; j < count; j++)
+			out[j].P = Vector3::Lerp(a[j].P, b[j].P, t);
+
+		if (mode == RotationBlendMode::Slerp)
+		{
+			for (size_t j = 0; j < count; j++)
+				out[j].Q.Slerp(a[j].Q, b[j].Q, t);
+			return;
+		}
+
+		size_t j = 0;
+#if ANIMIX_SSE
+		j = NLerp4(a, b, out, count, t);
+#endif
+		for (; j < count; j++)
+			NLerp(a[j].Q, b[j].Q, t, out[j].Q);
+	}
+
+	void BlendJointTransforms(const JointTransform* a, const JointTransform* b, JointTransform* out, const uint32_t* joints, size_t jointCount,
+		float t, RotationBlendMode mode)
+	{
+		// Masked joints are scattered through the pose, so they are blended one at a time
+		for (size_t i = 0; i < jointCount; i++)
+		{
+			const uint32_t j = joints[i];
+			BlendJointTransforms(a + j, b + j, out + j, 1, t, mode);
+		}
+	}
+
+	JointTransform SubtractJointTransform(const JointTransform& transform, const JointTransform& reference)
+	{
+		// reference * result = transform; the inverse of a unit quaternion is its conjugate
+		const gef::Quaternion inverseReference(-reference.Q.x, -reference.Q.y, -reference.Q.z, reference.Q.w);
+
+		JointTransform result;
+		result.P = { transform.P.X - reference.P.X, transform.P.Y - reference.P.Y, transform.P.Z - reference.P.Z };
+		result.Q = Multiply(inverseReference, transform.Q);
+		return result;
+	}
+
+	void AddJointTransforms(const JointTransform* base, const JointTransform* additive, JointTransform* out, size_t count, float weight)
+	{
+		// Additive positions are already differences, so each one is a single multiply-add
+		for (size_t j = 0; j < count; j++)
+		{
+			out[j].P = {
+				base[j].P.X + weight * additive[j].P.X,
+				base[j].P.Y + weight * additive[j].P.Y,
+				base[j].P.Z + weight * additive[j].P.Z
+			};
+		}
+
+		if (weight == 1.0f)
+		{
+			for (size_t j = 0; j < count; j++)
+				out[j].Q = Multiply(base[j].Q, additive[j].Q);
+			return;
+		}
+
+		// Otherwise scale each additive rotation by blending it from the identity
+		for (size_t j = 0; j < count; j++)
+		{
+			gef::Quaternion scaled;
+			NLerp(gef::Quaternion(0.0f, 0.0f, 0.0f, 1.0f), additive[j].Q, weight, scaled);
+			out[j].Q = Multiply(base[j].Q, scaled);
+		}
+	}
+
+	void AddJointTransforms(const JointTransform* base, const JointTransform* additive, JointTransform* out, const uint32_t* joints, size_t jointCount,
+		float weight)
+	{
+		for (size_t i = 0; i < jointCount; i++)
+		{
+			const uint32_t j = joints[i];
+			AddJointTransforms(base + j, additive + j, out + j, 1, weight);
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+#include "SIMD.h"
+#include "Skeleton.h"
+
+
+namespace Animix
+{
+	// How rotations are interpolated when blending poses
+	enum class RotationBlendMode : uint8_t
+	{
+		// Normalized lerp along the shortest path. Much cheaper than slerp, and the difference is
+		// imperceptible for the small angles between joint rotations of poses being blended
+		NLerp,
+		// Spherical lerp; constant angular velocity, but requires trig functions for every joint
+		Slerp
+	};
+
+	/**
+	 * Blend count joint transforms from a towards b.
+	 * out may be the same array as a or b
+	 */
+	void BlendJointTransforms(const JointTransform* a, const JointTransform* b, JointTransform* out, size_t count, float t, RotationBlendMode mode);
+
+	// Blend only the listed joints
+	void BlendJointTransforms(const JointTransform* a, const JointTransform* b, JointTransform* out, const uint32_t* joints, size_t jointCount,
+		float t, RotationBlendMode mode);
+
+	// The additive transform that takes reference to transform, in the local space of the joint
+	JointTransform SubtractJointTransform(const JointTransform& transform, const JointTransform& reference);
+
+	/**
+	 * Apply count additive transforms to base, scaled by weight.
+	 * out may be the same array as base or additive
+	 */
+	void AddJointTransforms(const JointTransform* base, const JointTransform* additive, JointTransform* out, size_t count, float weight);
+	// Apply only the listed joints
+	void AddJointTransforms(const JointTransform* base, const JointTransform* additive, JointTransform* out, const uint32_t* joints, size_t jointCount,
+		float weight);
+}
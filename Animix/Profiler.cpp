@@ -0,0 +1,211 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+#include "AnimationEngine.h"
+#include "JobSystem.h"
+
+
+namespace Animix
+{
+	namespace
+	{
+		constexpr double NS_TO_MS = 1.0 / 1000000.0;
+		constexpr double NS_TO_US = 1.0 / 1000.0;
+
+		// Stop recording a capture that has been left running, rather than using unbounded memory
+		constexpr size_t MAX_TRACE_EVENTS = 4 * 1024 * 1024;
+
+		void WriteJSONString(std::ostream& out, const char* str)
+		{
+			out << '"';
+			for (; *str; str++)
+			{
+				if (*str == '"' || *str == '\\')
+					out << '\\' << *str;
+				else if (static_cast<unsigned char>(*str) >= 0x20)
+					out << *str;
+			}
+			out << '"';
+		}
+	}
+
+
+	Profiler::Profiler()
+	{
+		m_Epoch = Now();
+		m_ThreadBuffers.resize(1);
+	}
+
+	void Profiler::SetThreadCount(size_t threadCount)
+	{
+		m_ThreadBuffers.resize(std::max<size_t>(threadCount, 1));
+	}
+
+
+	void Profiler::BeginFrame()
+	{
+		for (auto& buffer : m_ThreadBuffers)
+		{
+			buffer.Events.clear();
+			buffer.OpenEvents.clear();
+		}
+
+		m_FrameStart = Now();
+	}
+
+	void Profiler::EndFrame()
+	{
+		m_Report.FrameMs = static_cast<double>(Now() - m_FrameStart) * NS_TO_MS;
+		m_Report.Entries.clear();
+
+		for (uint32_t thread = 0; thread < m_ThreadBuffers.size(); thread++)
+		{
+			const ThreadBuffer& buffer = m_ThreadBuffers[thread];
+			assert(buffer.OpenEvents.empty() && "Profile scopes are still open at the end of the frame!");
+
+			for (const ProfileEvent& event : buffer.Events)
+			{
+				// There are only a handful of distinct scopes, so a linear search is fine
+				auto it = std::find_if(m_Report.Entries.begin(), m_Report.Entries.end(), [&event](const ProfileReportEntry& entry)
+					{
+						return entry.Name == event.Name && entry.Detail == event.Detail;
+					});
+				if (it == m_Report.Entries.end())
+				{
+					m_Report.Entries.emplace_back();
+					it = m_Report.Entries.end() - 1;
+					it->Name = event.Name;
+					it->Detail = event.Detail;
+				}
+
+				const double duration = static_cast<double>(event.End - event.Start) * NS_TO_MS;
+				it->Calls++;
+				it->TotalMs += duration;
+				it->SelfMs += static_cast<double>(event.End - event.Start - event.ChildTime) * NS_TO_MS;
+				it->MaxMs = std::max(it->MaxMs, duration);
+
+				if (m_CapturingTrace && m_TraceEvents.size() < MAX_TRACE_EVENTS)
+					m_TraceEvents.push_back({ event, thread });
+			}
+		}
+
+		std::sort(m_Report.Entries.begin(), m_Report.Entries.end(), [](const ProfileReportEntry& a, const ProfileReportEntry& b)
+			{
+				return a.SelfMs > b.SelfMs;
+			});
+	}
+
+
+	void Profiler::BeginTraceCapture()
+	{
+		m_TraceEvents.clear();
+		m_CapturingTrace = true;
+	}
+
+	bool Profiler::EndTraceCapture(const std::string& filename)
+	{
+		m_CapturingTrace = false;
+
+		std::ofstream file(filename);
+		if (!file.is_open())
+			return false;
+
+		// Complete events ("X") with timestamps and durations in microseconds
+		file << std::fixed << std::setprecision(3);
+		file << "{\"traceEvents\":[";
+		for (size_t i = 0; i < m_TraceEvents.size(); i++)
+		{
+			const TraceEvent& trace = m_TraceEvents[i];
+			const ProfileEvent& event = trace.Event;
+
+			file << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+			WriteJSONString(file, event.Name);
+			file << ",\"cat\":\"animix\",\"ph\":\"X\",\"pid\":1,\"tid\":" << trace.Thread
+				<< ",\"ts\":" << static_cast<double>(event.Start) * NS_TO_US
+				<< ",\"dur\":" << static_cast<double>(event.End - event.Start) * NS_TO_US
+				<< ",\"args\":{\"index\":" << event.Index;
+			if (event.Detail != 0)
+			{
+				file << ",\"detail\":";
+				WriteJSONString(file, GetInternedName(event.Detail).c_str());
+			}
+			file << "}}";
+		}
+		file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+		m_TraceEvents.clear();
+		m_TraceEvents.shrink_to_fit();
+		return file.good();
+	}
+
+
+	size_t Profiler::BeginEvent(const char* name, NameID detail, uint32_t index)
+	{
+		ThreadBuffer& buffer = GetThreadBuffer();
+
+		ProfileEvent event;
+		event.Name = name;
+		event.Detail = detail;
+		event.Index = index;
+		event.Depth = static_cast<uint32_t>(buffer.OpenEvents.size());
+		event.Start = Now();
+
+		buffer.Events.push_back(event);
+		buffer.OpenEvents.push_back(buffer.Events.size() - 1);
+		return buffer.Events.size() - 1;
+	}
+
+	void Profiler::EndEvent(size_t eventIndex)
+	{
+		ThreadBuffer& buffer = GetThreadBuffer();
+		assert(!buffer.OpenEvents.empty() && buffer.OpenEvents.back() == eventIndex && "Profile scopes must be nested!");
+
+		ProfileEvent& event = buffer.Events[eventIndex];
+		event.End = Now();
+
+		buffer.OpenEvents.pop_back();
+		if (!buffer.OpenEvents.empty())
+			buffer.Events[buffer.OpenEvents.back()].ChildTime += event.End - event.Start;
+	}
+
+	void Profiler::EndLastEvent()
+	{
+		const ThreadBuffer& buffer = GetThreadBuffer();
+		assert(!buffer.OpenEvents.empty());
+		EndEvent(buffer.OpenEvents.back());
+	}
+
+
+	uint64_t Profiler::Now() const
+	{
+		using namespace std::chrono;
+		return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count()) - m_Epoch;
+	}
+
+	Profiler::ThreadBuffer& Profiler::GetThreadBuffer()
+	{
+		return m_ThreadBuffers[JobSystem::GetCurrentThreadIndex()];
+	}
+
+
+	ProfileScope::ProfileScope(const char* name, NameID detail, uint32_t index)
+	{
+		Profiler& profiler = g_AnimixEngine->GetProfiler();
+		if (profiler.IsEnabled())
+		{
+			m_Profiler = &profiler;
+			m_Event = profiler.BeginEvent(name, detail, index);
+		}
+	}
+
+	ProfileScope::~ProfileScope()
+	{
+		if (m_Profiler)
+			m_Profiler->EndEvent(m_Event);
+	}
+}
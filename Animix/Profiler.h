@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "NameID.h"
+
+
+// Profiling scopes compile to nothing when ANIMIX_PROFILE is 0
+// When compiled in, nothing is recorded until the profiler is enabled at runtime
+#ifndef ANIMIX_PROFILE
+#define ANIMIX_PROFILE 1
+#endif
+
+#define ANIMIX_PROFILE_CONCAT_INNER(a, b) a##b
+#define ANIMIX_PROFILE_CONCAT(a, b) ANIMIX_PROFILE_CONCAT_INNER(a, b)
+
+#if ANIMIX_PROFILE
+// Name must be a string literal
+#define ANIMIX_PROFILE_SCOPE(name) ::Animix::ProfileScope ANIMIX_PROFILE_CONCAT(profileScope, __LINE__)(name)
+// Detail is a NameID to tell apart scopes with the same name (eg which state or clip), and index is any number (eg which animator or node)
+#define ANIMIX_PROFILE_SCOPE_DETAIL(name, detail, index) ::Animix::ProfileScope ANIMIX_PROFILE_CONCAT(profileScope, __LINE__)(name, detail, index)
+#else
+#define ANIMIX_PROFILE_SCOPE(name)
+#define ANIMIX_PROFILE_SCOPE_DETAIL(name, detail, index)
+#endif
+
+
+namespace Animix
+{
+	struct ProfileEvent
+	{
+		const char* Name = nullptr;
+		NameID Detail = 0;
+		uint32_t Index = 0;
+		uint32_t Depth = 0;
+
+		// Nanoseconds since the profiler was created
+		uint64_t Start = 0;
+		uint64_t End = 0;
+		// Time spent in nested scopes
+		uint64_t ChildTime = 0;
+	};
+
+	// The combined timings of all scopes with the same name and detail in one frame
+	struct ProfileReportEntry
+	{
+		const char* Name = nullptr;
+		NameID Detail = 0;
+		uint32_t Calls = 0;
+		double TotalMs = 0.0;		// Including nested scopes
+		double SelfMs = 0.0;		// Excluding nested scopes
+		double MaxMs = 0.0;			// Longest single call
+	};
+
+	struct ProfileReport
+	{
+		double FrameMs = 0.0;
+		// Sorted by self time, most expensive first
+		std::vector<ProfileReportEntry> Entries;
+	};
+
+
+	/**
+	 * Records the timings of scopes in the animation hot path.
+	 * Each thread that updates animators records into its own buffer, which are combined into a report at the end of every tick.
+	 * Frames can also be captured and exported in Chrome trace event format, to be viewed in chrome://tracing or Perfetto
+	 */
+	class Profiler
+	{
+	public:
+		Profiler();
+
+		// Disallow copying
+		Profiler(const Profiler&) = delete;
+		Profiler& operator=(const Profiler&) = delete;
+
+		// Default moving
+		Profiler(Profiler&&) = default;
+		Profiler& operator=(Profiler&&) = default;
+
+
+		inline bool IsEnabled() const { return m_Enabled; }
+		inline void SetEnabled(bool enabled) { m_Enabled = enabled; }
+
+		// One buffer per JobSystem thread; must not be called during a frame
+		void SetThreadCount(size_t threadCount);
+
+		// Called by the engine around each tick
+		void BeginFrame();
+		void EndFrame();
+
+		// The report from the most recently completed frame
+		inline const ProfileReport& GetReport() const { return m_Report; }
+
+		// Every frame between beginning and ending a capture is written to filename as Chrome trace event JSON
+		void BeginTraceCapture();
+		bool EndTraceCapture(const std::string& filename);
+		inline bool IsCapturingTrace() const { return m_CapturingTrace; }
+
+		// Used by ProfileScope
+		size_t BeginEvent(const char* name, NameID detail, uint32_t index);
+		void EndEvent(size_t event);
+		// Ends the innermost open event, for callers that cannot keep the index, such as compiled blend trees
+		void EndLastEvent();
+
+	private:
+		struct ThreadBuffer
+		{
+			std::vector<ProfileEvent> Events;
+			std::vector<size_t> OpenEvents;		// Stack of scopes that have begun but not ended
+		};
+
+		struct TraceEvent
+		{
+			ProfileEvent Event;
+			uint32_t Thread = 0;
+		};
+
+		uint64_t Now() const;
+		ThreadBuffer& GetThreadBuffer();
+
+	private:
+		bool m_Enabled = false;
+
+		uint64_t m_Epoch = 0;
+		uint64_t m_FrameStart = 0;
+
+		std::vector<ThreadBuffer> m_ThreadBuffers;
+		ProfileReport m_Report;
+
+		bool m_CapturingTrace = false;
+		std::vector<TraceEvent> m_TraceEvents;
+	};
+
+
+	/**
+	 * Times the scope it is declared in, if the engine's profiler is enabled
+	 * Use through the ANIMIX_PROFILE_SCOPE macros, so that it can be compiled out
+	 */
+	class ProfileScope
+	{
+	public:
+		ProfileScope(const char* name, NameID detail = 0, uint32_t index = 0);
+		~ProfileScope();
+
+		// Disallow copying and moving
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+		ProfileScope(ProfileScope&&) = delete;
+		ProfileScope& operator=(ProfileScope&&) = delete;
+
+	private:
+		Profiler* m_Profiler = nullptr;
+		size_t m_Event = 0;
+	};
+}
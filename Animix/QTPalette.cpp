@@ -0,0 +1,83 @@
+#include "QTPalette.h"
+
+#include <cassert>
+#include <cmath>
+
+
+namespace Animix
+{
+	QTTransform ToQTTransform(const AffineTransform& transform)
+	{
+		// Element (row, column) of the row-vector matrix
+		const auto m = [&transform](int row, int column) { return transform.Columns[column][row]; };
+
+		// Taken from the largest component, so that the division is never by a number near zero
+		QTTransform result;
+		gef::Quaternion& q = result.Rotation;
+		const float trace = m(0, 0) + m(1, 1) + m(2, 2);
+		if (trace > 0.0f)
+		{
+			const float s = 0.5f / sqrtf(trace + 1.0f);
+			q.w = 0.25f / s;
+			q.x = (m(1, 2) - m(2, 1)) * s;
+			q.y = (m(2, 0) - m(0, 2)) * s;
+			q.z = (m(0, 1) - m(1, 0)) * s;
+		}
+		else if (m(0, 0) > m(1, 1) && m(0, 0) > m(2, 2))
+		{
+			const float s = 0.5f / sqrtf(1.0f + m(0, 0) - m(1, 1) - m(2, 2));
+			q.w = (m(1, 2) - m(2, 1)) * s;
+			q.x = 0.25f / s;
+			q.y = (m(1, 0) + m(0, 1)) * s;
+			q.z = (m(2, 0) + m(0, 2)) * s;
+		}
+		else if (m(1, 1) > m(2, 2))
+		{
+			const float s = 0.5f / sqrtf(1.0f + m(1, 1) - m(0, 0) - m(2, 2));
+			q.w = (m(2, 0) - m(0, 2)) * s;
+			q.x = (m(1, 0) + m(0, 1)) * s;
+			q.y = 0.25f / s;
+			q.z = (m(2, 1) + m(1, 2)) * s;
+		}
+		else
+		{
+			const float s = 0.5f / sqrtf(1.0f + m(2, 2) - m(0, 0) - m(1, 1));
+			q.w = (m(0, 1) - m(1, 0)) * s;
+			q.x = (m(2, 0) + m(0, 2)) * s;
+			q.y = (m(2, 1) + m(1, 2)) * s;
+			q.z = 0.25f / s;
+		}
+
+		result.Translation = transform.GetTranslation();
+		return result;
+	}
+
+	QTTransform LerpQT(const QTTransform& a, const QTTransform& b, float t)
+	{
+		// Take the shortest path between the rotations
+		const float dot = a.Rotation.x * b.Rotation.x + a.Rotation.y * b.Rotation.y + a.Rotation.z * b.Rotation.z + a.Rotation.w * b.Rotation.w;
+		const float tb = dot < 0.0f ? -t : t;
+		const float ta = 1.0f - t;
+
+		QTTransform result;
+		result.Rotation = {
+			ta * a.Rotation.x + tb * b.Rotation.x,
+			ta * a.Rotation.y + tb * b.Rotation.y,
+			ta * a.Rotation.z + tb * b.Rotation.z,
+			ta * a.Rotation.w + tb * b.Rotation.w
+		};
+		result.Rotation.Normalise();
+		result.Translation = Vector3::Lerp(a.Translation, b.Translation, t);
+		return result;
+	}
+
+	void BuildQTPalette(const Skeleton& skeleton, const AffineTransform* globalPose, QTTransform* outPalette)
+	{
+		assert(skeleton.RigidInvBindPose && "Quaternion-translation palettes cannot hold a scaled inverse bind pose!");
+
+		// The same SIMD transforms as the matrix palette; only converting the result differs
+		const size_t jointCount = skeleton.Joints.size();
+		for (size_t joint = 0; joint < jointCount; joint++)
+			outPalette[joint] = ToQTTransform(skeleton.InvBindPoseAffine[joint] * globalPose[joint]);
+	}
+}
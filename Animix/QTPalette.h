@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Skeleton.h"
+
+
+namespace Animix
+{
+	// How an animator writes its skinning palette; the renderer must use a skinning shader for the same format
+	enum class PaletteFormat : uint8_t
+	{
+		// A gef::Matrix44 per joint, for gef's default skinning shader
+		Matrix,
+		// A QTTransform per joint; half the size, for default_3d_skinning_qt_shader_vs
+		QuaternionTranslation
+	};
+
+	// The rotation and translation of a rigid transform
+	QTTransform ToQTTransform(const AffineTransform& transform);
+
+	// Blends translations linearly and rotations by normalised lerp; t outside [0, 1] extrapolates
+	QTTransform LerpQT(const QTTransform& a, const QTTransform& b, float t);
+
+	/**
+	 * Build the quaternion-translation palette of a global pose.
+	 * Each joint's inverse bind pose is applied to its global transform, as for matrix palettes, and the rotation taken from the result.
+	 * The CPU cost is that of the matrix palette plus the conversion; the saving is in the size of the palette sent to the GPU.
+	 * The skeleton's inverse bind pose must be rigid
+	 */
+	void BuildQTPalette(const Skeleton& skeleton, const AffineTransform* globalPose, QTTransform* outPalette);
+}
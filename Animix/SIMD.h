@@ -0,0 +1,13 @@
+#pragma once
+
+
+// SSE is available on every x86 target we build for; other platforms use the scalar kernels
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+#define ANIMIX_SSE 1
+#else
+#define ANIMIX_SSE 0
+#endif
+
+#if ANIMIX_SSE
+#include <xmmintrin.h>
+#endif
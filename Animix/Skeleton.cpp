@@ -1,12 +1,60 @@
 #include "Skeleton.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include "AnimationEngine.h"
+#include "PoseBlend.h"
 
 
 namespace Animix
 {
+	JointMask::JointMask(const Skeleton& skeleton)
+		: Weights(skeleton.Joints.size(), 0.0f)
+	{
+	}
+
+	void JointMask::SetWeight(const Skeleton& skeleton, size_t joint, float weight, bool includeChildren)
+	{
+		assert(Weights.size() == skeleton.Joints.size() && joint < Weights.size());
+		Weights[joint] = weight;
+
+		// Parents always come before their children, so one pass finds the whole subtree
+		if (includeChildren)
+		{
+			std::vector<bool> inSubtree(Weights.size(), false);
+			inSubtree[joint] = true;
+			for (size_t child = joint + 1; child < Weights.size(); child++)
+			{
+				const int32_t parent = skeleton.Joints[child].Parent;
+				if (parent != -1 && inSubtree[parent])
+				{
+					inSubtree[child] = true;
+					Weights[child] = weight;
+				}
+			}
+		}
+
+		Joints.clear();
+		for (uint32_t j = 0; j < Weights.size(); j++)
+		{
+			if (Weights[j] != 0.0f)
+				Joints.push_back(j);
+		}
+	}
+
+
+	int32_t Skeleton::FindJoint(gef::StringId name) const
+	{
+		for (size_t joint = 0; joint < Joints.size(); joint++)
+		{
+			if (Joints[joint].Name == name)
+				return static_cast<int32_t>(joint);
+		}
+		return -1;
+	}
+
+
 	SkeletonPose::SkeletonPose(SkeletonID skeleton)
 		: SkID(skeleton)
 	{
@@ -24,16 +72,10 @@ namespace Animix
 		for (size_t jointIndex = 0; jointIndex < skeleton->Joints.size(); jointIndex++)
 		{
 			const int32_t parent = skeleton->Joints[jointIndex].Parent;
-			gef::Matrix44& globalPose = GlobalPose[jointIndex];
-
-			auto& t = LocalPose[jointIndex];
-
-			globalPose.SetIdentity();
-			globalPose.Rotation(t.Q);
-			globalPose.SetTranslation(t.P.ToVector4());
+			const auto& t = LocalPose[jointIndex];
 
-			if (parent != -1)
-				globalPose = globalPose * GlobalPose[parent];
+			const AffineTransform local = AffineTransform::FromRotationTranslation(t.Q, t.P);
+			GlobalPose[jointIndex] = parent == -1 ? local : local * GlobalPose[parent];
 		}
 	}
 
@@ -47,22 +89,13 @@ namespace Animix
 		for (size_t jointIndex = 0; jointIndex < skeleton->Joints.size(); jointIndex++)
 		{
 			const int32_t parent = skeleton->Joints[jointIndex].Parent;
-			gef::Matrix44 local;
-
-			if (parent == -1)
-			{
-				local = GlobalPose[jointIndex];
-			}
-			else
-			{
-				gef::Matrix44 invParent;
-				invParent.Inverse(GlobalPose[parent]);
-				local = GlobalPose[jointIndex] * invParent;
-			}
+			const AffineTransform local = parent == -1
+				? GlobalPose[jointIndex]
+				: GlobalPose[jointIndex] * AffineTransform::Inverse(GlobalPose[parent]);
 
 			auto& localPose = LocalPose[jointIndex];
-			localPose.P = { local.GetTranslation().x(), local.GetTranslation().y(), local.GetTranslation().z()};
-			localPose.Q = gef::Quaternion(local);
+			localPose.P = local.GetTranslation();
+			localPose.Q = gef::Quaternion(local.ToMatrix());
 		}
 	}
 
@@ -74,29 +107,85 @@ namespace Animix
 		// Assumes that the given local pose is valid
 		for (size_t jointIndex = 0; jointIndex < skeleton->Joints.size(); jointIndex++)
 		{
-			const Joint& joint = skeleton->Joints[jointIndex];
-			GlobalPose[jointIndex].Inverse(joint.InvBindPose);
+			GlobalPose[jointIndex] = AffineTransform::Inverse(skeleton->InvBindPoseAffine[jointIndex]);
 		}
 	}
 
-	SkeletonPose SkeletonPose::Lerp(const SkeletonPose& pose1, const SkeletonPose& pose2, float t)
+	void SkeletonPose::Lerp(const SkeletonPose& pose1, const SkeletonPose& pose2, float t, SkeletonPose& outPose)
 	{
 		// Otherwise perform blending
-		assert(pose1.SkID == pose2.SkID);
-		SkeletonPose out(pose1.SkID);
+		assert(pose1.SkID == pose2.SkID && pose1.SkID == outPose.SkID);
+
+		// Blend parameters often sit at an extreme, where there is nothing to blend
+		if (t == 0.0f || t == 1.0f)
+		{
+			outPose.CopyLocalPose(t == 0.0f ? pose1 : pose2);
+			return;
+		}
 
 		// LinearBlend local poses
-		for (size_t j = 0; j < out.LocalPose.size(); j++)
+		if (outPose.Mask)
+		{
+			BlendJointTransforms(pose1.LocalPose.data(), pose2.LocalPose.data(), outPose.LocalPose.data(),
+				outPose.Mask->Joints.data(), outPose.Mask->Joints.size(), t, g_AnimixEngine->GetRotationBlendMode());
+			return;
+		}
+		BlendJointTransforms(pose1.LocalPose.data(), pose2.LocalPose.data(), outPose.LocalPose.data(), outPose.LocalPose.size(), t,
+			g_AnimixEngine->GetRotationBlendMode());
+	}
+
+	void SkeletonPose::Add(const SkeletonPose& base, const SkeletonPose& additive, float weight, SkeletonPose& outPose)
+	{
+		assert(base.SkID == additive.SkID && base.SkID == outPose.SkID);
+
+		if (weight == 0.0f)
+		{
+			outPose.CopyLocalPose(base);
+			return;
+		}
+
+		if (outPose.Mask)
 		{
-			// Perform a linear blend between this joint in pose1 and pose2
-			const JointTransform& j1 = pose1.LocalPose[j];
-			const JointTransform& j2 = pose2.LocalPose[j];
-			JointTransform& jo = out.LocalPose[j];
+			AddJointTransforms(base.LocalPose.data(), additive.LocalPose.data(), outPose.LocalPose.data(),
+				outPose.Mask->Joints.data(), outPose.Mask->Joints.size(), weight);
+			return;
+		}
+		AddJointTransforms(base.LocalPose.data(), additive.LocalPose.data(), outPose.LocalPose.data(), outPose.LocalPose.size(), weight);
+	}
 
-			jo.P = Vector3::Lerp(j1.P, j2.P, t);
-			jo.Q.Slerp(j1.Q, j2.Q, t);
+	void SkeletonPose::Layer(const SkeletonPose& base, const SkeletonPose& overlay, const JointMask& mask, float weight, SkeletonPose& outPose)
+	{
+		assert(base.SkID == overlay.SkID && base.SkID == outPose.SkID);
+		assert(mask.Weights.size() == outPose.LocalPose.size());
+
+		outPose.CopyLocalPose(base);
+		if (weight == 0.0f)
+			return;
+
+		// Joints have different weights, so each is blended on its own
+		const RotationBlendMode mode = g_AnimixEngine->GetRotationBlendMode();
+		for (const uint32_t joint : mask.Joints)
+		{
+			// outPose may not need every masked joint, when it is itself masked
+			if (outPose.Mask && outPose.Mask->Weights[joint] == 0.0f)
+				continue;
+
+			const float t = weight * mask.Weights[joint];
+			BlendJointTransforms(&outPose.LocalPose[joint], &overlay.LocalPose[joint], &outPose.LocalPose[joint], 1, t, mode);
 		}
+	}
+
+	void SkeletonPose::CopyLocalPose(const SkeletonPose& source)
+	{
+		if (&source == this)
+			return;
 
-		return out;
+		if (Mask)
+		{
+			for (const uint32_t joint : Mask->Joints)
+				LocalPose[joint] = source.LocalPose[joint];
+			return;
+		}
+		std::copy(source.LocalPose.begin(), source.LocalPose.end(), LocalPose.begin());
 	}
 }
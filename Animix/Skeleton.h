@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 
+#include "AffineTransform.h"
 #include "Vector3.h"
 #include "maths/matrix44.h"
 #include "maths/quaternion.h"
@@ -20,6 +21,15 @@ namespace Animix
 		gef::Quaternion Q;
 	};
 
+	// A rigid transform as a rotation and translation, laid out as two float4s for a skinning shader
+	struct QTTransform
+	{
+		gef::Quaternion Rotation;
+		Vector3 Translation;
+		float Padding = 0.0f;
+	};
+	static_assert(sizeof(QTTransform) == 32, "QTTransform must match the skinning shader's layout");
+
 	struct Joint
 	{
 		gef::StringId Name;
@@ -27,11 +37,34 @@ namespace Animix
 		gef::Matrix44 InvBindPose;
 	};
 
+	// Forward declarations
+	struct Skeleton;
+
+	/**
+	 * A weight for each joint of a skeleton, for blending only part of a pose, such as the upper body
+	 */
+	struct JointMask
+	{
+		std::vector<float> Weights;
+		// The joints with a weight other than 0, in skeleton order
+		std::vector<uint32_t> Joints;
+
+
+		JointMask() = default;
+		// Every joint starts with a weight of 0
+		JointMask(const Skeleton& skeleton);
+
+		// Set the weight of a joint, and optionally of every joint below it
+		void SetWeight(const Skeleton& skeleton, size_t joint, float weight, bool includeChildren = true);
+	};
+
 	struct SkeletonPose
 	{
 		SkeletonID SkID = -1;
 		std::vector<JointTransform> LocalPose;
-		std::vector<gef::Matrix44> GlobalPose;
+		std::vector<AffineTransform> GlobalPose;
+		// If set, only the masked joints of the local pose are needed; the rest are left undefined by sampling and blending
+		const JointMask* Mask = nullptr;
 
 
 		// Constructor
@@ -41,12 +74,31 @@ namespace Animix
 		void RecoverLocalPoseFromGlobal();
 		void BuildBindPose();
 
-		static SkeletonPose Lerp(const SkeletonPose& pose1, const SkeletonPose& pose2, float t);
+		// Only the joints in the mask of outPose are blended, if it has one
+		// outPose may be the same pose as pose1 or pose2
+		// A t of exactly 0 or 1 copies the local pose of pose1 or pose2, if it is not already outPose
+		static void Lerp(const SkeletonPose& pose1, const SkeletonPose& pose2, float t, SkeletonPose& outPose);
+		// Apply a pose sampled from additive clips on top of base, scaled by weight
+		// outPose may be the same pose as base or additive
+		static void Add(const SkeletonPose& base, const SkeletonPose& additive, float weight, SkeletonPose& outPose);
+		// Blend each masked joint from base towards overlay by its weight in the mask, scaled by weight; other joints come from base
+		// overlay only needs to hold the masked joints. outPose may be the same pose as base
+		static void Layer(const SkeletonPose& base, const SkeletonPose& overlay, const JointMask& mask, float weight, SkeletonPose& outPose);
+
+	private:
+		void CopyLocalPose(const SkeletonPose& source);
 	};
 
 	struct Skeleton
 	{
 		SkeletonID ID;
 		std::vector<Joint> Joints;
+		// The inverse bind pose of each joint, for building palettes
+		std::vector<AffineTransform> InvBindPoseAffine;
+		// Quaternion-translation palettes cannot hold the scale of an inverse bind pose, as exported when converting units
+		bool RigidInvBindPose = true;
+
+		// Returns -1 if there is no joint with the name
+		int32_t FindJoint(gef::StringId name) const;
 	};
 }
@@ -26,40 +26,46 @@ namespace Animix
 	AnimatorState::AnimatorState(Animator* owner, std::string name)
 		: m_Owner(owner)
 		, m_Name(std::move(name))
+		, m_ID(InternName(m_Name))
 	{
 		assert(m_Owner);
 		m_BlendTree = std::make_unique<BlendTree>();
 	}
 
-	bool AnimatorState::EvaluateBlendTree(SkeletonPose& outPose) const
+	bool AnimatorState::EvaluateBlendTree(SkeletonPose& outPose, float deltaTime) const
 	{
-		return m_BlendTree->TickAndEvaluateTree(outPose);
+		return m_BlendTree->TickAndEvaluateTree(outPose, deltaTime);
 	}
 
 	
 	void AnimatorState::AddTransition(const std::string& name, StateTransition&& transition)
 	{
-		if (m_Transitions.find(name) == m_Transitions.end())
-			m_Transitions.emplace(name, std::move(transition));
+		const NameID id = InternName(name);
+		if (m_Transitions.find(id) == m_Transitions.end())
+		{
+			transition.DestinationStateID = InternName(transition.DestinationState);
+			m_Transitions.emplace(id, std::move(transition));
+		}
 	}
 
-	bool AnimatorState::HasTransition(const std::string& transitionName)
+	bool AnimatorState::HasTransition(NameID transitionID) const
 	{
-		return m_Transitions.find(transitionName) != m_Transitions.end();
+		return m_Transitions.find(transitionID) != m_Transitions.end();
 	}
 
-	const StateTransition& AnimatorState::GetTransition(const std::string& transitionName) const
+	const StateTransition& AnimatorState::GetTransition(NameID transitionID) const
 	{
-		return m_Transitions.at(transitionName);
+		return m_Transitions.at(transitionID);
 	}
 
 
 	void AnimatorState::SetEndTransition(const std::string& name)
 	{
-		if (m_Transitions.find(name) != m_Transitions.end())
+		const NameID id = HashName(name);
+		if (m_Transitions.find(id) != m_Transitions.end())
 		{
 			m_HasEndTransition = true;
-			m_EndTransition = name;
+			m_EndTransition = id;
 		}
 	}
 }
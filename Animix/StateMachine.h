@@ -2,6 +2,7 @@
 #include <unordered_map>
 
 #include "Blending/BlendTree.h"
+#include "NameID.h"
 
 
 namespace Animix
@@ -23,6 +24,7 @@ namespace Animix
 		std::string DestinationState;
 		TransitionType Type = TransitionType::Immediate;
 		float Duration = 0.0f;
+		NameID DestinationStateID = 0;		// Set when the transition is added to a state
 
 		static TransitionType TransitionTypeFromString(const std::string& name);
 	};
@@ -37,35 +39,39 @@ namespace Animix
 		AnimatorState(Animator* owner, std::string name);
 
 		// Evaluate the state
-		bool EvaluateBlendTree(SkeletonPose& outPose) const;
+		bool EvaluateBlendTree(SkeletonPose& outPose, float deltaTime) const;
 
 		// Get/Manipulate transitions
 		void AddTransition(const std::string& name, StateTransition&& transition);
-		bool HasTransition(const std::string& transitionName);
-		const StateTransition& GetTransition(const std::string& transitionName) const;
+		bool HasTransition(NameID transitionID) const;
+		inline bool HasTransition(const std::string& transitionName) const { return HasTransition(HashName(transitionName)); }
+		const StateTransition& GetTransition(NameID transitionID) const;
+		inline const StateTransition& GetTransition(const std::string& transitionName) const { return GetTransition(HashName(transitionName)); }
 
 		void SetEndTransition(const std::string& name);
 		inline bool HasEndTransition() const { return m_HasEndTransition; }
-		inline const std::string& GetEndTransition() const { return m_EndTransition; }
+		inline NameID GetEndTransition() const { return m_EndTransition; }
 
 		// Getters
 		inline Animator* GetOwner() const { return m_Owner; }
 		inline const std::string& GetName() const { return m_Name; }
+		inline NameID GetID() const { return m_ID; }
 		inline BlendTree* GetBlendTree() const { return m_BlendTree.get(); }
 
 	private:
 		// A pointer to the owning state machine
 		Animator* m_Owner = nullptr;
 		std::string m_Name;
+		NameID m_ID = 0;
 
 		std::unique_ptr<BlendTree> m_BlendTree;
-		// Map of transition names to transitions
+		// Map of transition IDs to transitions
 		// Checking if a transition exists is a common operation, so it should be as fast as possible
-		std::unordered_map<std::string, StateTransition> m_Transitions;
+		std::unordered_map<NameID, StateTransition> m_Transitions;
 
 		// What transition should occur when this state finishes playing
 		// (only applies to non-looping states)
 		bool m_HasEndTransition = false;
-		std::string m_EndTransition;
+		NameID m_EndTransition = 0;
 	};
 }
@@ -0,0 +1,61 @@
+/*
+ * Replaces the global allocation functions to count heap allocations.
+ * These are kept out of the benchmark's translation unit, so the compiler never sees operator new and delete
+ * inlined into the same function as a new expression, which would pair them with malloc and free
+ */
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+namespace
+{
+	std::atomic<uint64_t> g_AllocationCount{ 0 };
+
+	void* CountedAllocate(size_t size)
+	{
+		g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+		if (void* ptr = malloc(size ? size : 1))
+			return ptr;
+		throw std::bad_alloc();
+	}
+}
+
+
+uint64_t GetAllocationCount()
+{
+	return g_AllocationCount.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+	return CountedAllocate(size);
+}
+
+void* operator new[](size_t size)
+{
+	return CountedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
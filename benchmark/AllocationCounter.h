@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+
+// The number of heap allocations made by the process so far, through any form of operator new
+uint64_t GetAllocationCount();
@@ -0,0 +1,851 @@
+/*
+ * Headless benchmark for the Animix runtime.
+ * Generates synthetic skeletons and clips, builds a blend tree of each node type,
+ * and measures the cost of updating animators without any rendering or platform layer.
+ *
+ * Usage: AnimixBenchmark [animators] [frames] [workers] [update interval] [trace file]
+ * Exits with 1 if any tree allocates from the heap once the engine has reached its steady state,
+ * if quaternion-translation skinning does not match the matrix palette, or if key reduction makes a compressed clip larger
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Animix/AnimationEngine.h"
+#include "Animix/Blending/AdditiveBlendNode.h"
+#include "Animix/Blending/BilinearBlendNode.h"
+#include "Animix/Blending/BlendSpace2DNode.h"
+#include "Animix/Blending/ClipSampleNode.h"
+#include "Animix/Blending/GeneralLinearBlendNode.h"
+#include "Animix/Blending/LayerBlendNode.h"
+#include "Animix/Blending/LinearBlendNode.h"
+#include "Animix/KeyReduction.h"
+#include "Animix/QTPalette.h"
+#include "AllocationCounter.h"
+#include "CacheMissCounter.h"
+#include "JointSamplesClip.h"
+
+
+namespace
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	constexpr float FRAME_TIME = 1.0f / 60.0f;
+	constexpr float KEY_RATE = 30.0f;
+	constexpr size_t CLIP_COUNT = 4;
+	constexpr size_t POSE_ITERATIONS = 2000;
+
+	const size_t JOINT_COUNTS[] = { 30, 100, 300 };
+
+	enum class TreeType
+	{
+		Clip,
+		Linear,
+		GeneralLinear,
+		Bilinear,
+		Nested,		// Two levels deep, like the walk state of the demo character
+		BlendSpace,	// The clips of Nested, placed freely in a single 2D blend space
+		Additive,	// An additive clip layered on a linear blend
+		Layer,		// A linear blend over a quarter of the joints of another, like an upper body action
+		Finished	// A non-looping clip that has reached its end, so the pose does not change
+	};
+
+	const TreeType TREE_TYPES[] = { TreeType::Clip, TreeType::Linear, TreeType::GeneralLinear, TreeType::Bilinear, TreeType::Nested, TreeType::BlendSpace, TreeType::Additive, TreeType::Layer, TreeType::Finished };
+
+	const char* TreeTypeName(TreeType type)
+	{
+		switch (type)
+		{
+		case TreeType::Clip:			return "Clip";
+		case TreeType::Linear:			return "Linear";
+		case TreeType::GeneralLinear:	return "GeneralLinear";
+		case TreeType::Bilinear:		return "Bilinear";
+		case TreeType::Nested:			return "Nested";
+		case TreeType::BlendSpace:		return "BlendSpace";
+		case TreeType::Additive:		return "Additive";
+		case TreeType::Layer:			return "Layer";
+		case TreeType::Finished:		return "Finished";
+		}
+		return "";
+	}
+
+	double NanosecondsSince(Clock::time_point start)
+	{
+		return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+	}
+
+
+	gef::Quaternion AxisAngle(float x, float y, float z, float angle)
+	{
+		const float length = sqrtf(x * x + y * y + z * z);
+		const float s = sinf(0.5f * angle) / length;
+		return { x * s, y * s, z * s, cosf(0.5f * angle) };
+	}
+
+	// Joints branch off the root in chains of five, like limbs, fingers and spines
+	Animix::SkeletonID CreateSkeleton(Animix::AnimationEngine& engine, size_t jointCount)
+	{
+		constexpr float BONE_LENGTH = 10.0f;
+
+		std::vector<Animix::Joint> joints(jointCount);
+		std::vector<int32_t> depths(jointCount, 0);
+		for (size_t i = 0; i < jointCount; i++)
+		{
+			Animix::Joint& joint = joints[i];
+			joint.Name = gef::GetStringId("joint" + std::to_string(i));
+			joint.Parent = i == 0 ? -1 : (i % 5 == 1 ? 0 : static_cast<int32_t>(i) - 1);
+			depths[i] = joint.Parent == -1 ? 0 : depths[joint.Parent] + 1;
+
+			// Bind pose is a straight line up from the root
+			joint.InvBindPose.SetIdentity();
+			joint.InvBindPose.SetTranslation(gef::Vector4(0.0f, -BONE_LENGTH * depths[i], 0.0f));
+		}
+
+		return engine.CreateSkeleton(std::move(joints));
+	}
+
+	// How a synthetic clip is processed, mirroring the loader's import settings
+	struct ClipOptions
+	{
+		// Stored as the difference from its first frame
+		bool Additive = false;
+		// With the loader's default tolerances
+		bool ReduceKeys = false;
+		bool Compress = false;
+	};
+
+	struct ClipStats
+	{
+		uint32_t KeysBeforeReduction = 0;
+		uint32_t KeysRemoved = 0;
+		Animix::ClipCompressionReport Compression;
+	};
+
+	// Roughly a quarter of joints are static, as fingers, face and twist bones often are in real clips
+	// The same keys can also be stored in the per-joint layout the packed clip replaced
+	void CreateClip(Animix::AnimationEngine& engine, Animix::SkeletonID skeleton, const std::string& name, float duration, float frequency,
+		const ClipOptions& options = ClipOptions(), ClipStats* outStats = nullptr, JointSamplesClip* outJointSamples = nullptr)
+	{
+		constexpr float BONE_LENGTH = 10.0f;
+		constexpr float POSITION_TOLERANCE = 0.01f;
+		constexpr float ROTATION_TOLERANCE = 0.001f;
+
+		const size_t jointCount = engine.GetSkeleton(skeleton)->Joints.size();
+		const uint32_t keyCount = static_cast<uint32_t>(ceilf(duration * KEY_RATE)) + 1;
+
+		ClipStats stats;
+		std::vector<std::vector<Animix::PositionKey>> positionKeys(jointCount);
+		std::vector<std::vector<Animix::RotationKey>> rotationKeys(jointCount);
+		for (size_t joint = 0; joint < jointCount; joint++)
+		{
+			const bool animated = joint % 4 != 3;
+			const float phase = 0.37f * static_cast<float>(joint);
+
+			for (uint32_t key = 0; key < keyCount; key++)
+			{
+				const float time = std::min(static_cast<float>(key) / KEY_RATE, duration);
+				const float wave = animated ? sinf(6.2831853f * frequency * time / duration + phase) : 0.0f;
+
+				// Only the root translates; every other joint sits at the end of its parent's bone
+				const Animix::Vector3 position = joint == 0
+					? Animix::Vector3{ 5.0f * wave, 0.0f, 20.0f * time }
+					: Animix::Vector3{ 0.0f, BONE_LENGTH, 0.0f };
+				const gef::Quaternion rotation = AxisAngle(
+					1.0f + 0.1f * (joint % 3), 0.5f * (joint % 2), 0.25f + 0.1f * (joint % 5), 0.1f + 0.6f * wave);
+
+				positionKeys[joint].push_back({ time, position });
+				rotationKeys[joint].push_back({ time, rotation });
+			}
+
+			stats.KeysBeforeReduction += 2 * keyCount;
+			if (options.ReduceKeys)
+			{
+				stats.KeysRemoved += Animix::ReducePositionKeys(positionKeys[joint], POSITION_TOLERANCE);
+				stats.KeysRemoved += Animix::ReduceRotationKeys(rotationKeys[joint], ROTATION_TOLERANCE);
+			}
+		}
+
+		std::vector<uint32_t> positionKeyCounts(jointCount);
+		std::vector<uint32_t> rotationKeyCounts(jointCount);
+		for (size_t joint = 0; joint < jointCount; joint++)
+		{
+			positionKeyCounts[joint] = static_cast<uint32_t>(positionKeys[joint].size());
+			rotationKeyCounts[joint] = static_cast<uint32_t>(rotationKeys[joint].size());
+		}
+
+		Animix::AnimationClip* clip = engine.CreateAnimationClip(name, skeleton);
+		clip->SetDuration(duration);
+		clip->AllocateTracks(positionKeyCounts, rotationKeyCounts);
+
+		for (size_t joint = 0; joint < jointCount; joint++)
+		{
+			for (size_t key = 0; key < positionKeys[joint].size(); key++)
+				clip->SetPositionKey(joint, key, positionKeys[joint][key].StartTime, positionKeys[joint][key].Value);
+			for (size_t key = 0; key < rotationKeys[joint].size(); key++)
+				clip->SetRotationKey(joint, key, rotationKeys[joint][key].StartTime, rotationKeys[joint][key].Value);
+		}
+
+		if (outJointSamples)
+		{
+			// Constant tracks keep a single key, as the packed clip keeps them in its base pose, so that only the layout differs
+			for (size_t joint = 0; joint < jointCount; joint++)
+			{
+				JointSamplesClip::JointSamples samples;
+				samples.PositionKeys = positionKeys[joint];
+				samples.RotationKeys = rotationKeys[joint];
+				if (std::all_of(samples.PositionKeys.begin(), samples.PositionKeys.end(), [&samples](const Animix::PositionKey& key)
+					{ return memcmp(&key.Value, &samples.PositionKeys[0].Value, sizeof(key.Value)) == 0; }))
+					samples.PositionKeys.resize(1);
+				if (std::all_of(samples.RotationKeys.begin(), samples.RotationKeys.end(), [&samples](const Animix::RotationKey& key)
+					{ return memcmp(&key.Value, &samples.RotationKeys[0].Value, sizeof(key.Value)) == 0; }))
+					samples.RotationKeys.resize(1);
+				outJointSamples->SetJointSamples(joint, std::move(samples));
+			}
+		}
+
+		if (options.Additive)
+		{
+			Animix::SkeletonPose reference(skeleton);
+			clip->BuildLocalPose(0.0f, reference);
+			clip->MakeAdditive(reference);
+		}
+
+		clip->ExtractConstantTracks();
+
+		if (options.Compress)
+			clip->Compress(Animix::ClipCompressionSettings(), &stats.Compression);
+
+		if (outStats)
+			*outStats = stats;
+	}
+
+	std::string ClipName(size_t jointCount, size_t clip)
+	{
+		return "bench" + std::to_string(jointCount) + "_" + std::to_string(clip);
+	}
+
+	std::string AdditiveClipName(size_t jointCount)
+	{
+		return "bench" + std::to_string(jointCount) + "_additive";
+	}
+
+	Animix::BlendNodeID CreateClipNode(Animix::BlendTree* tree, const std::string& clipName, bool looping = true)
+	{
+		const auto node = tree->CreateNode<Animix::ClipSampleNode>();
+		node->SetClip(clipName);
+		node->SetLooping(looping);
+		return node->GetNodeID();
+	}
+
+	void CreateAnimator(Animix::AnimationEngine& engine, Animix::SkeletonID skeleton, size_t jointCount, TreeType type, size_t index, uint32_t updateInterval)
+	{
+		Animix::Animator* animator = engine.GetAnimator(engine.CreateAnimator(skeleton));
+		animator->SetLODTier({ 0.0f, updateInterval, Animix::PaletteApproximation::Interpolate });
+		Animix::BlendTree* tree = animator->CreateState("bench")->GetBlendTree();
+
+		// Offset the clips used by each animator, so that animators do not all sample the same clip at the same time
+		const auto clipName = [jointCount, index](size_t input) { return ClipName(jointCount, (index + input) % CLIP_COUNT); };
+
+		switch (type)
+		{
+		case TreeType::Clip:
+			{
+				tree->SetOutputNode(CreateClipNode(tree, clipName(0)));
+				break;
+			}
+		case TreeType::Linear:
+			{
+				const auto node = tree->CreateNode<Animix::LinearBlendNode>();
+				node->SetInput(0, CreateClipNode(tree, clipName(0)));
+				node->SetInput(1, CreateClipNode(tree, clipName(1)));
+				node->SetAlpha(0.4f);
+				tree->SetOutputNode(node->GetNodeID());
+				break;
+			}
+		case TreeType::GeneralLinear:
+			{
+				const auto node = tree->CreateNode<Animix::GeneralLinearBlendNode>();
+				for (size_t input = 0; input < 3; input++)
+				{
+					node->SetInput(input, CreateClipNode(tree, clipName(input)));
+					node->SetAlphaForInput(input, 0.5f * static_cast<float>(input));
+				}
+				node->SetAlpha(0.7f);
+				tree->SetOutputNode(node->GetNodeID());
+				break;
+			}
+		case TreeType::Bilinear:
+			{
+				const auto node = tree->CreateNode<Animix::BilinearBlendNode>();
+				for (size_t input = 0; input < 4; input++)
+					node->SetInput(input, CreateClipNode(tree, clipName(input)));
+				node->SetAlpha(0.3f);
+				node->SetBeta(0.6f);
+				tree->SetOutputNode(node->GetNodeID());
+				break;
+			}
+		case TreeType::Nested:
+			{
+				// A bilinear blend of two general linear blends and two clips
+				const auto node = tree->CreateNode<Animix::BilinearBlendNode>();
+				for (size_t input = 0; input < 2; input++)
+				{
+					const auto general = tree->CreateNode<Animix::GeneralLinearBlendNode>();
+					for (size_t generalInput = 0; generalInput < 3; generalInput++)
+					{
+						general->SetInput(generalInput, CreateClipNode(tree, clipName(input + generalInput)));
+						general->SetAlphaForInput(generalInput, static_cast<float>(generalInput) - 1.0f);
+					}
+					general->SetAlpha(0.4f);
+					node->SetInput(input, general->GetNodeID());
+				}
+				node->SetInput(2, CreateClipNode(tree, clipName(2)));
+				node->SetInput(3, CreateClipNode(tree, clipName(3)));
+				node->SetAlpha(0.3f);
+				node->SetBeta(0.6f);
+				tree->SetOutputNode(node->GetNodeID());
+				break;
+			}
+		case TreeType::BlendSpace:
+			{
+				const float positions[][2] = { { -1.0f, 0.0f }, { 0.0f, 0.0f }, { 1.0f, 0.0f }, { -1.0f, 1.0f },
+					{ 0.0f, 1.2f }, { 1.0f, 1.0f }, { -0.5f, -1.0f }, { 0.5f, -1.0f } };
+
+				const auto node = tree->CreateNode<Animix::BlendSpace2DNode>();
+				for (size_t input = 0; input < 8; input++)
+				{
+					node->SetInput(input, CreateClipNode(tree, clipName(input)));
+					node->SetPositionForInput(input, positions[input][0], positions[input][1]);
+				}
+				node->Triangulate();
+				node->SetPosition(0.3f, 0.6f);
+				tree->SetOutputNode(node->GetNodeID());
+				break;
+			}
+		case TreeType::Additive:
+			{
+				const auto base = tree->CreateNode<Animix::LinearBlendNode>();
+				base->SetInput(0, CreateClipNode(tree, clipName(0)));
+				base->SetInput(1, CreateClipNode(tree, clipName(1)));
+				base->SetAlpha(0.4f);
+
+				const auto node = tree->CreateNode<Animix::AdditiveBlendNode>();
+				node->SetInput(0, base->GetNodeID());
+				node->SetInput(1, CreateClipNode(tree, AdditiveClipName(jointCount)));
+				node->SetWeight(0.5f);
+				tree->SetOutputNode(node->GetNodeID());
+				break;
+			}
+		case TreeType::Layer:
+			{
+				const auto base = tree->CreateNode<Animix::LinearBlendNode>();
+				base->SetInput(0, CreateClipNode(tree, clipName(0)));
+				base->SetInput(1, CreateClipNode(tree, clipName(1)));
+				base->SetAlpha(0.4f);
+
+				const auto overlay = tree->CreateNode<Animix::LinearBlendNode>();
+				overlay->SetInput(0, CreateClipNode(tree, clipName(2)));
+				overlay->SetInput(1, CreateClipNode(tree, clipName(3)));
+				overlay->SetAlpha(0.6f);
+
+				// Whole chains off the root, so the mask covers subtrees
+				const Animix::Skeleton& joints = *engine.GetSkeleton(skeleton);
+				Animix::JointMask mask(joints);
+				for (size_t chain = 1; chain < jointCount / 4; chain += 5)
+					mask.SetWeight(joints, chain, 1.0f);
+
+				const auto node = tree->CreateNode<Animix::LayerBlendNode>();
+				node->SetInput(0, base->GetNodeID());
+				node->SetInput(1, overlay->GetNodeID());
+				node->SetMask(std::move(mask));
+				node->SetWeight(0.8f);
+				tree->SetOutputNode(node->GetNodeID());
+				break;
+			}
+		case TreeType::Finished:
+			{
+				tree->SetOutputNode(CreateClipNode(tree, clipName(0), false));
+				break;
+			}
+		}
+
+		tree->Start();
+	}
+
+
+	struct Settings
+	{
+		size_t Animators = 100;
+		size_t Frames = 300;
+		uint32_t Workers = 0;
+		uint32_t UpdateInterval = 1;
+		std::string TraceFile;		// If set, a profiled run is exported here
+	};
+
+	void PopulateEngine(Animix::AnimationEngine& engine, const Settings& settings, size_t jointCount, TreeType type)
+	{
+		engine.SetWorkerCount(settings.Workers);
+
+		const Animix::SkeletonID skeleton = CreateSkeleton(engine, jointCount);
+		for (size_t clip = 0; clip < CLIP_COUNT; clip++)
+			CreateClip(engine, skeleton, ClipName(jointCount, clip), 1.0f + 0.25f * clip, 1.0f + clip);
+		ClipOptions additive;
+		additive.Additive = true;
+		CreateClip(engine, skeleton, AdditiveClipName(jointCount), 0.8f, 2.0f, additive);
+		for (size_t animator = 0; animator < settings.Animators; animator++)
+			CreateAnimator(engine, skeleton, jointCount, type, animator, settings.UpdateInterval);
+
+		// Let pools and caches reach their steady state before measuring
+		// This is also long enough for every non-looping clip to finish
+		for (size_t frame = 0; frame < 120; frame++)
+			engine.Tick(FRAME_TIME);
+	}
+
+	// Measure a whole engine tick of many animators, all using the same kind of tree
+	// Returns the number of heap allocations made once the engine reached its steady state, which should be none
+	uint64_t BenchmarkTick(const Settings& settings, size_t jointCount, TreeType type)
+	{
+		Animix::AnimationEngine engine;
+		PopulateEngine(engine, settings, jointCount, type);
+
+		const uint64_t allocations = GetAllocationCount();
+		const auto start = Clock::now();
+		for (size_t frame = 0; frame < settings.Frames; frame++)
+			engine.Tick(FRAME_TIME);
+		const double elapsed = NanosecondsSince(start);
+		const uint64_t frameAllocations = GetAllocationCount() - allocations;
+
+		// Transient memory is shared between all animators updated on the same thread
+		size_t arenaPoses = 0;
+		size_t arenaBytes = 0;
+		for (size_t arena = 0; arena < engine.GetFrameArenaCount(); arena++)
+		{
+			arenaPoses += engine.GetFrameArena(arena).GetPoseHighWaterMark();
+			arenaBytes += engine.GetFrameArena(arena).GetHighWaterMark();
+		}
+
+		const double perFrame = elapsed / settings.Frames;
+		const double perAnimator = perFrame / settings.Animators;
+		printf("%-14s %7zu %10.1f %12.1f %10.2f %12.2f %12zu %12zu %10zu\n",
+			TreeTypeName(type), jointCount, perFrame / 1000.0, perAnimator, perAnimator / jointCount,
+			static_cast<double>(frameAllocations) / settings.Frames, arenaPoses, arenaBytes, engine.GetSkippedAnimatorCount());
+		return frameAllocations;
+	}
+
+	// Measure sampling a clip and building the global pose in isolation
+	void BenchmarkPose(size_t jointCount)
+	{
+		Animix::AnimationEngine engine;
+		const Animix::SkeletonID skeleton = CreateSkeleton(engine, jointCount);
+		CreateClip(engine, skeleton, ClipName(jointCount, 0), 1.0f, 1.0f);
+		const Animix::AnimationClip* clip = engine.GetAnimationClip(ClipName(jointCount, 0));
+
+		Animix::SkeletonPose pose(skeleton);
+		Animix::KeyCursorCache cursors;
+
+		auto start = Clock::now();
+		for (size_t i = 0; i < POSE_ITERATIONS; i++)
+			clip->BuildLocalPose(fmodf(i * FRAME_TIME, clip->GetDuration()), pose, &cursors);
+		const double localPose = NanosecondsSince(start) / POSE_ITERATIONS;
+
+		start = Clock::now();
+		for (size_t i = 0; i < POSE_ITERATIONS; i++)
+			pose.BuildGlobalPose();
+		const double globalPose = NanosecondsSince(start) / POSE_ITERATIONS;
+
+		// Palettes from the local pose, both through the global pose
+		const Animix::Skeleton& sk = *engine.GetSkeleton(skeleton);
+		std::vector<gef::Matrix44> matrixPalette(jointCount);
+		start = Clock::now();
+		for (size_t i = 0; i < POSE_ITERATIONS; i++)
+		{
+			pose.BuildGlobalPose();
+			for (size_t joint = 0; joint < jointCount; joint++)
+				(sk.InvBindPoseAffine[joint] * pose.GlobalPose[joint]).ToMatrix(matrixPalette[joint]);
+		}
+		const double matrixPaletteTime = NanosecondsSince(start) / POSE_ITERATIONS;
+
+		std::vector<Animix::QTTransform> qtPalette(jointCount);
+		start = Clock::now();
+		for (size_t i = 0; i < POSE_ITERATIONS; i++)
+		{
+			pose.BuildGlobalPose();
+			Animix::BuildQTPalette(sk, pose.GlobalPose.data(), qtPalette.data());
+		}
+		const double qtPaletteTime = NanosecondsSince(start) / POSE_ITERATIONS;
+
+		printf("%7zu %18.2f %18.2f %18.2f %18.2f\n", jointCount, localPose / jointCount, globalPose / jointCount,
+			matrixPaletteTime / jointCount, qtPaletteTime / jointCount);
+	}
+	// Compare sampling the packed clip layout against the per-joint key vectors it replaced
+	// Many clips are sampled in turn, as by a crowd of animators, so that their keys do not all stay in the cache
+	void BenchmarkLayout(size_t jointCount)
+	{
+		constexpr size_t LAYOUT_CLIPS = 32;
+
+		Animix::AnimationEngine engine;
+		const Animix::SkeletonID skeleton = CreateSkeleton(engine, jointCount);
+		Animix::SkeletonPose pose(skeleton);
+
+		std::vector<const Animix::AnimationClip*> clips;
+		std::vector<JointSamplesClip> jointSamplesClips;
+		size_t packedSize = 0;
+		for (size_t clip = 0; clip < LAYOUT_CLIPS; clip++)
+		{
+			const std::string name = ClipName(jointCount, clip) + "Layout";
+			jointSamplesClips.emplace_back(jointCount);
+			CreateClip(engine, skeleton, name, 1.0f, 1.0f + 0.1f * clip, ClipOptions(), nullptr, &jointSamplesClips.back());
+			clips.push_back(engine.GetAnimationClip(name));
+			packedSize += clips.back()->GetKeyDataSize();
+		}
+
+		CacheMissCounter counter;
+		const auto measure = [&counter](const char* layout, size_t jointCount, const auto& samplePose)
+		{
+			std::vector<Animix::KeyCursorCache> cursors(LAYOUT_CLIPS);
+
+			// Each clip advances by a frame every time it is sampled
+			const auto time = [](size_t i) { return fmodf((i / LAYOUT_CLIPS) * FRAME_TIME, 1.0f); };
+
+			uint64_t l1Misses, lastLevelMisses;
+			counter.Start();
+			const auto start = Clock::now();
+			for (size_t i = 0; i < POSE_ITERATIONS; i++)
+				samplePose(i % LAYOUT_CLIPS, time(i), cursors[i % LAYOUT_CLIPS]);
+			const double samplePoseTime = NanosecondsSince(start) / POSE_ITERATIONS;
+			counter.Stop(l1Misses, lastLevelMisses);
+
+			if (counter.IsAvailable())
+			{
+				printf("%7zu %-14s %12.1f %16.1f %16.1f\n", jointCount, layout, samplePoseTime,
+					static_cast<double>(l1Misses) / POSE_ITERATIONS, static_cast<double>(lastLevelMisses) / POSE_ITERATIONS);
+			}
+			else
+			{
+				printf("%7zu %-14s %12.1f %16s %16s\n", jointCount, layout, samplePoseTime, "n/a", "n/a");
+			}
+		};
+
+		measure("JointSamples", jointCount, [&](size_t clip, float time, Animix::KeyCursorCache& cursors)
+			{
+				jointSamplesClips[clip].BuildLocalPose(time, pose, &cursors);
+			});
+		measure("Packed", jointCount, [&](size_t clip, float time, Animix::KeyCursorCache& cursors)
+			{
+				clips[clip]->BuildLocalPose(time, pose, &cursors);
+			});
+	}
+
+	// Compare sampling clips stored at full precision against clips reduced and quantized on import
+	// Returns false if reducing keys before compressing made the compressed clip larger
+	bool BenchmarkCompression(size_t jointCount)
+	{
+		struct Variant
+		{
+			const char* Name;
+			bool ReduceKeys;
+			bool Compress;
+		};
+		const Variant VARIANTS[] = { { "Raw", false, false }, { "Reduced", true, false }, { "Compressed", false, true }, { "Reduced+Compressed", true, true } };
+
+		Animix::AnimationEngine engine;
+		const Animix::SkeletonID skeleton = CreateSkeleton(engine, jointCount);
+		Animix::SkeletonPose pose(skeleton);
+
+		size_t rawSize = 0;
+		size_t compressedSize[2] = {};
+		for (const Variant& variant : VARIANTS)
+		{
+			ClipOptions options;
+			options.ReduceKeys = variant.ReduceKeys;
+			options.Compress = variant.Compress;
+
+			ClipStats stats;
+			const std::string name = ClipName(jointCount, 0) + variant.Name;
+			CreateClip(engine, skeleton, name, 1.0f, 1.0f, options, &stats);
+			const Animix::AnimationClip* clip = engine.GetAnimationClip(name);
+
+			Animix::KeyCursorCache cursors;
+			const auto start = Clock::now();
+			for (size_t i = 0; i < POSE_ITERATIONS; i++)
+				clip->BuildLocalPose(fmodf(i * FRAME_TIME, clip->GetDuration()), pose, &cursors);
+			const double localPose = NanosecondsSince(start) / POSE_ITERATIONS;
+
+			const size_t size = clip->GetKeyDataSize();
+			if (!rawSize)
+				rawSize = size;
+			if (variant.Compress)
+				compressedSize[variant.ReduceKeys ? 1 : 0] = size;
+
+			printf("%7zu %-20s %14.2f %12zu %10.2f %12u %12.4f %12.5f\n", jointCount, variant.Name, localPose / jointCount, size,
+				static_cast<double>(rawSize) / size, stats.KeysRemoved, stats.Compression.MaxPositionError, stats.Compression.MaxRotationError);
+		}
+
+		return compressedSize[1] <= compressedSize[0];
+	}
+
+	// Compare affine transforms against the general Matrix44 path they replaced, for the global pose and palette
+	void BenchmarkTransforms(size_t jointCount)
+	{
+		Animix::AnimationEngine engine;
+		const Animix::SkeletonID skeleton = CreateSkeleton(engine, jointCount);
+		CreateClip(engine, skeleton, ClipName(jointCount, 0), 1.0f, 1.0f);
+		const Animix::AnimationClip* clip = engine.GetAnimationClip(ClipName(jointCount, 0));
+		const Animix::Skeleton& sk = *engine.GetSkeleton(skeleton);
+
+		Animix::SkeletonPose pose(skeleton);
+		clip->BuildLocalPose(0.5f, pose, nullptr);
+
+		std::vector<gef::Matrix44> matrixGlobalPose(jointCount);
+		std::vector<gef::Matrix44> palette(jointCount);
+
+		auto start = Clock::now();
+		for (size_t i = 0; i < POSE_ITERATIONS; i++)
+		{
+			for (size_t joint = 0; joint < jointCount; joint++)
+			{
+				gef::Matrix44& global = matrixGlobalPose[joint];
+				global.SetIdentity();
+				global.Rotation(pose.LocalPose[joint].Q);
+				global.SetTranslation(pose.LocalPose[joint].P.ToVector4());
+				if (sk.Joints[joint].Parent != -1)
+					global = global * matrixGlobalPose[sk.Joints[joint].Parent];
+			}
+		}
+		const double matrixGlobal = NanosecondsSince(start) / POSE_ITERATIONS;
+
+		start = Clock::now();
+		for (size_t i = 0; i < POSE_ITERATIONS; i++)
+		{
+			for (size_t joint = 0; joint < jointCount; joint++)
+				palette[joint] = sk.Joints[joint].InvBindPose * matrixGlobalPose[joint];
+		}
+		const double matrixPalette = NanosecondsSince(start) / POSE_ITERATIONS;
+
+		start = Clock::now();
+		for (size_t i = 0; i < POSE_ITERATIONS; i++)
+			pose.BuildGlobalPose();
+		const double affineGlobal = NanosecondsSince(start) / POSE_ITERATIONS;
+
+		start = Clock::now();
+		for (size_t i = 0; i < POSE_ITERATIONS; i++)
+		{
+			for (size_t joint = 0; joint < jointCount; joint++)
+				(sk.InvBindPoseAffine[joint] * pose.GlobalPose[joint]).ToMatrix(palette[joint]);
+		}
+		const double affinePalette = NanosecondsSince(start) / POSE_ITERATIONS;
+
+		printf("%7zu %20.2f %20.2f %20.2f %20.2f\n", jointCount,
+			matrixGlobal / jointCount, affineGlobal / jointCount, matrixPalette / jointCount, affinePalette / jointCount);
+	}
+
+	// Skin a point by a row of a matrix palette
+	Animix::Vector3 SkinPoint(const Animix::AffineTransform& transform, const Animix::Vector3& point)
+	{
+		const auto column = [&transform, &point](int index)
+		{
+			const float* c = transform.Columns[index];
+			return c[0] * point.X + c[1] * point.Y + c[2] * point.Z + c[3];
+		};
+		return { column(0), column(1), column(2) };
+	}
+
+	// Skin a point as default_3d_skinning_qt_shader_vs does
+	Animix::Vector3 SkinPoint(const Animix::QTTransform& transform, const Animix::Vector3& point)
+	{
+		const gef::Quaternion& q = transform.Rotation;
+		const float tx = 2.0f * (q.y * point.Z - q.z * point.Y);
+		const float ty = 2.0f * (q.z * point.X - q.x * point.Z);
+		const float tz = 2.0f * (q.x * point.Y - q.y * point.X);
+		return {
+			point.X + q.w * tx + (q.y * tz - q.z * ty) + transform.Translation.X,
+			point.Y + q.w * ty + (q.z * tx - q.x * tz) + transform.Translation.Y,
+			point.Z + q.w * tz + (q.x * ty - q.y * tx) + transform.Translation.Z
+		};
+	}
+
+	// Check that quaternion-translation palettes skin as matrix palettes do, and are refused for skeletons they cannot represent
+	// The demo character needs gef to load, so its skeleton is stood in for by one whose bind pose is rotated at every joint
+	bool CheckQTSkinning(size_t jointCount)
+	{
+		constexpr float BONE_LENGTH = 10.0f;
+		constexpr float TOLERANCE = 1e-3f;
+
+		Animix::AnimationEngine engine;
+
+		const auto createSkeleton = [&engine, jointCount](float bindScale)
+		{
+			std::vector<Animix::Joint> joints(jointCount);
+			std::vector<Animix::AffineTransform> bindPose(jointCount);
+			for (size_t i = 0; i < jointCount; i++)
+			{
+				Animix::Joint& joint = joints[i];
+				joint.Name = gef::GetStringId("joint" + std::to_string(i));
+				joint.Parent = i == 0 ? -1 : (i % 5 == 1 ? 0 : static_cast<int32_t>(i) - 1);
+
+				const Animix::AffineTransform local = Animix::AffineTransform::FromRotationTranslation(
+					AxisAngle(0.2f, 1.0f, 0.3f * (i % 4), 0.4f + 0.1f * i), { 0.0f, i == 0 ? 0.0f : BONE_LENGTH, 0.0f });
+				bindPose[i] = joint.Parent == -1 ? local : local * bindPose[joint.Parent];
+
+				// Scaled inverse bind poses are what exporters write when converting units
+				Animix::AffineTransform invBindPose = Animix::AffineTransform::Inverse(bindPose[i]);
+				for (auto& column : invBindPose.Columns)
+				{
+					for (float& element : column)
+						element *= bindScale;
+				}
+				joint.InvBindPose = invBindPose.ToMatrix();
+			}
+			return engine.CreateSkeleton(std::move(joints));
+		};
+
+		const Animix::SkeletonID skeleton = createSkeleton(1.0f);
+		const Animix::SkeletonID scaledSkeleton = createSkeleton(100.0f);
+		CreateClip(engine, skeleton, "qt check", 2.0f, 1.0f);
+		const Animix::AnimationClip* clip = engine.GetAnimationClip("qt check");
+		const Animix::Skeleton& sk = *engine.GetSkeleton(skeleton);
+
+		Animix::SkeletonPose pose(skeleton);
+		std::vector<Animix::QTTransform> qtPalette(jointCount);
+		float maxError = 0.0f;
+		for (float time = 0.0f; time < clip->GetDuration(); time += 0.1f)
+		{
+			clip->BuildLocalPose(time, pose);
+			pose.BuildGlobalPose();
+			Animix::BuildQTPalette(sk, pose.GlobalPose.data(), qtPalette.data());
+
+			for (size_t joint = 0; joint < jointCount; joint++)
+			{
+				const Animix::AffineTransform matrix = sk.InvBindPoseAffine[joint] * pose.GlobalPose[joint];
+				for (const Animix::Vector3& offset : { Animix::Vector3{ 0.0f, 0.0f, 0.0f }, Animix::Vector3{ 3.0f, -2.0f, 1.0f }, Animix::Vector3{ -1.0f, 4.0f, 5.0f } })
+				{
+					// A vertex near the joint in bind space
+					const Animix::Vector3 point = SkinPoint(Animix::AffineTransform::Inverse(sk.InvBindPoseAffine[joint]), offset);
+					const Animix::Vector3 expected = SkinPoint(matrix, point);
+					const Animix::Vector3 actual = SkinPoint(qtPalette[joint], point);
+					maxError = std::max({ maxError, fabsf(expected.X - actual.X), fabsf(expected.Y - actual.Y), fabsf(expected.Z - actual.Z) });
+				}
+			}
+		}
+
+		Animix::Animator* animator = engine.GetAnimator(engine.CreateAnimator(scaledSkeleton));
+		const bool scaledRefused = !engine.GetSkeleton(scaledSkeleton)->RigidInvBindPose
+			&& !animator->SetPaletteFormat(Animix::PaletteFormat::QuaternionTranslation)
+			&& animator->GetPaletteFormat() == Animix::PaletteFormat::Matrix;
+
+		const bool passed = maxError < TOLERANCE && scaledRefused;
+		printf("QT skinning of %zu joints: max error %g against the matrix palette, scaled bind pose %s\n",
+			jointCount, maxError, scaledRefused ? "refused" : "accepted");
+		return passed;
+	}
+
+	// Profile a few frames of a representative tree, printing the report and exporting a trace
+	void ProfileTick(const Settings& settings, size_t jointCount, TreeType type)
+	{
+		constexpr size_t PROFILE_FRAMES = 10;
+
+		Animix::AnimationEngine engine;
+		PopulateEngine(engine, settings, jointCount, type);
+
+		Animix::Profiler& profiler = engine.GetProfiler();
+		profiler.SetEnabled(true);
+		profiler.BeginTraceCapture();
+		for (size_t frame = 0; frame < PROFILE_FRAMES; frame++)
+			engine.Tick(FRAME_TIME);
+		const bool exported = profiler.EndTraceCapture(settings.TraceFile);
+
+		const Animix::ProfileReport& report = profiler.GetReport();
+		printf("\nProfile of the last frame of %s with %zu joints: %.3f ms\n", TreeTypeName(type), jointCount, report.FrameMs);
+		printf("%-36s %-12s %8s %10s %10s %10s\n", "Scope", "Detail", "Calls", "Self ms", "Total ms", "Max ms");
+		for (const Animix::ProfileReportEntry& entry : report.Entries)
+		{
+			printf("%-36s %-12s %8u %10.3f %10.3f %10.3f\n",
+				entry.Name, Animix::GetInternedName(entry.Detail).c_str(), entry.Calls, entry.SelfMs, entry.TotalMs, entry.MaxMs);
+		}
+		printf(exported ? "Trace written to %s\n" : "Failed to write trace to %s\n", settings.TraceFile.c_str());
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+	if (argc > 1)
+		settings.Animators = std::max<size_t>(strtoul(argv[1], nullptr, 10), 1);
+	if (argc > 2)
+		settings.Frames = std::max<size_t>(strtoul(argv[2], nullptr, 10), 1);
+	if (argc > 3)
+		settings.Workers = static_cast<uint32_t>(strtoul(argv[3], nullptr, 10));
+	if (argc > 4)
+		settings.UpdateInterval = std::max<uint32_t>(static_cast<uint32_t>(strtoul(argv[4], nullptr, 10)), 1);
+	if (argc > 5)
+		settings.TraceFile = argv[5];
+
+	printf("Animix benchmark: %zu animators, %zu frames, %u workers, updating every %u frames\n\n",
+		settings.Animators, settings.Frames, settings.Workers, settings.UpdateInterval);
+
+	printf("%7s %18s %18s %18s %18s\n", "Joints", "LocalPose ns/jnt", "GlobalPose ns/jnt", "Matrix pal ns/jnt", "QT pal ns/jnt");
+	for (const size_t jointCount : JOINT_COUNTS)
+		BenchmarkPose(jointCount);
+	printf("\n");
+
+	printf("%7s %20s %20s %20s %20s\n", "Joints", "Mat44 global ns/jnt", "Affine global ns/jnt", "Mat44 pal ns/jnt", "Affine pal ns/jnt");
+	for (const size_t jointCount : JOINT_COUNTS)
+		BenchmarkTransforms(jointCount);
+	printf("\n");
+
+	bool failed = false;
+	for (const size_t jointCount : JOINT_COUNTS)
+	{
+		if (!CheckQTSkinning(jointCount))
+		{
+			fprintf(stderr, "Quaternion-translation skinning of %zu joints does not match the matrix palette\n", jointCount);
+			failed = true;
+		}
+	}
+	printf("\n");
+
+	printf("%7s %-14s %12s %16s %16s\n", "Joints", "Layout", "ns/pose", "L1D misses/pose", "LLC misses/pose");
+	for (const size_t jointCount : JOINT_COUNTS)
+		BenchmarkLayout(jointCount);
+	printf("\n");
+
+	printf("%7s %-20s %14s %12s %10s %12s %12s %12s\n",
+		"Joints", "Clip", "Sample ns/jnt", "key bytes", "ratio", "keys removed", "max pos err", "max rot err");
+	for (const size_t jointCount : JOINT_COUNTS)
+	{
+		if (!BenchmarkCompression(jointCount))
+		{
+			fprintf(stderr, "Reducing keys made the compressed clip with %zu joints larger\n", jointCount);
+			failed = true;
+		}
+	}
+	printf("\n");
+
+	printf("%-14s %7s %10s %12s %10s %12s %12s %12s %10s\n",
+		"Tree", "Joints", "us/frame", "ns/animator", "ns/joint", "allocs/frame", "arena poses", "arena bytes", "skipped");
+	for (const TreeType type : TREE_TYPES)
+	{
+		for (const size_t jointCount : JOINT_COUNTS)
+		{
+			if (BenchmarkTick(settings, jointCount, type) > 0)
+			{
+				fprintf(stderr, "%s with %zu joints allocated from the heap after reaching its steady state\n", TreeTypeName(type), jointCount);
+				failed = true;
+			}
+		}
+	}
+
+	if (!settings.TraceFile.empty())
+		ProfileTick(settings, 100, TreeType::Bilinear);
+
+	// Updating animators must never allocate, so that frame times do not depend on the heap
+	return failed ? 1 : 0;
+}
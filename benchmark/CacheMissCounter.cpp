@@ -0,0 +1,78 @@
+#include "CacheMissCounter.h"
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+#if defined(__linux__)
+namespace
+{
+	int OpenCounter(uint32_t type, uint64_t config)
+	{
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+
+	uint64_t ReadCounter(int file)
+	{
+		uint64_t count = 0;
+		return read(file, &count, sizeof(count)) == sizeof(count) ? count : 0;
+	}
+}
+
+CacheMissCounter::CacheMissCounter()
+{
+	m_L1File = OpenCounter(PERF_TYPE_HW_CACHE,
+		PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+	m_LastLevelFile = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+	if (m_L1File >= 0)
+		close(m_L1File);
+	if (m_LastLevelFile >= 0)
+		close(m_LastLevelFile);
+}
+
+void CacheMissCounter::Start()
+{
+	if (!IsAvailable())
+		return;
+
+	for (const int file : { m_L1File, m_LastLevelFile })
+	{
+		ioctl(file, PERF_EVENT_IOC_RESET, 0);
+		ioctl(file, PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+void CacheMissCounter::Stop(uint64_t& outL1Misses, uint64_t& outLastLevelMisses)
+{
+	outL1Misses = outLastLevelMisses = 0;
+	if (!IsAvailable())
+		return;
+
+	for (const int file : { m_L1File, m_LastLevelFile })
+		ioctl(file, PERF_EVENT_IOC_DISABLE, 0);
+	outL1Misses = ReadCounter(m_L1File);
+	outLastLevelMisses = ReadCounter(m_LastLevelFile);
+}
+#else
+CacheMissCounter::CacheMissCounter() {}
+CacheMissCounter::~CacheMissCounter() {}
+void CacheMissCounter::Start() {}
+void CacheMissCounter::Stop(uint64_t& outL1Misses, uint64_t& outLastLevelMisses) { outL1Misses = outLastLevelMisses = 0; }
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+
+/**
+ * Counts the data cache misses of the calling thread, from the CPU's hardware counters.
+ * Only available on Linux, and only where the kernel allows reading the counters (perf_event_paranoid) and the CPU or VM exposes them
+ */
+class CacheMissCounter
+{
+public:
+	CacheMissCounter();
+	~CacheMissCounter();
+
+	// Disallow copying
+	CacheMissCounter(const CacheMissCounter&) = delete;
+	CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+
+	inline bool IsAvailable() const { return m_L1File >= 0 && m_LastLevelFile >= 0; }
+
+	void Start();
+	// Misses since Start, in the level 1 data cache and the last level cache
+	void Stop(uint64_t& outL1Misses, uint64_t& outLastLevelMisses);
+
+private:
+	int m_L1File = -1;
+	int m_LastLevelFile = -1;
+};
@@ -0,0 +1,99 @@
+#include "JointSamplesClip.h"
+
+#include <algorithm>
+
+#include "Animix/Skeleton.h"
+
+
+namespace
+{
+	// How many keys to step forward from the cursor before giving up and searching
+	constexpr uint32_t MAX_CURSOR_STEPS = 4;
+
+	// Finds the index of the last key that starts at or before time, or the first key if time is before all keys
+	template<typename KeyType>
+	size_t FindKeyIndex(const std::vector<KeyType>& keys, float time, uint32_t* cursor)
+	{
+		const size_t lastKey = keys.size() - 1;
+
+		if (cursor)
+		{
+			size_t keyIndex = std::min<size_t>(*cursor, lastKey);
+
+			// The cursor can only be used as a starting point if time has not gone backwards past it
+			if (keyIndex == 0 || time >= keys[keyIndex].StartTime)
+			{
+				uint32_t steps = 0;
+				for (; steps < MAX_CURSOR_STEPS && keyIndex < lastKey && time >= keys[keyIndex + 1].StartTime; keyIndex++, steps++)
+				{}
+
+				if (keyIndex == lastKey || time < keys[keyIndex + 1].StartTime)
+				{
+					*cursor = static_cast<uint32_t>(keyIndex);
+					return keyIndex;
+				}
+			}
+		}
+
+		const auto it = std::upper_bound(keys.begin() + 1, keys.end(), time,
+			[](float t, const KeyType& key) { return t < key.StartTime; });
+		const size_t keyIndex = static_cast<size_t>(it - keys.begin()) - 1;
+
+		if (cursor)
+			*cursor = static_cast<uint32_t>(keyIndex);
+		return keyIndex;
+	}
+}
+
+
+void JointSamplesClip::BuildLocalPose(float time, Animix::SkeletonPose& outPose, Animix::KeyCursorCache* cursors) const
+{
+	if (cursors && cursors->PositionCursors.size() != m_JointSamples.size())
+	{
+		cursors->PositionCursors.assign(m_JointSamples.size(), 0);
+		cursors->RotationCursors.assign(m_JointSamples.size(), 0);
+	}
+
+	for (size_t joint = 0; joint < m_JointSamples.size(); joint++)
+	{
+		const JointSamples& samples = m_JointSamples[joint];
+
+		Animix::Vector3 posePosition;
+		gef::Quaternion poseRotation;
+
+		if (!samples.PositionKeys.empty())
+		{
+			const size_t keyIndex = FindKeyIndex(samples.PositionKeys, time, cursors ? &cursors->PositionCursors[joint] : nullptr);
+			const Animix::PositionKey& startKey = samples.PositionKeys[keyIndex];
+			if (keyIndex == samples.PositionKeys.size() - 1)
+			{
+				posePosition = startKey.Value;
+			}
+			else
+			{
+				const Animix::PositionKey& endKey = samples.PositionKeys[keyIndex + 1];
+				const float t = (time - startKey.StartTime) / (endKey.StartTime - startKey.StartTime);
+				posePosition = Animix::Vector3::Lerp(startKey.Value, endKey.Value, t);
+			}
+		}
+
+		if (!samples.RotationKeys.empty())
+		{
+			const size_t keyIndex = FindKeyIndex(samples.RotationKeys, time, cursors ? &cursors->RotationCursors[joint] : nullptr);
+			const Animix::RotationKey& startKey = samples.RotationKeys[keyIndex];
+			if (keyIndex == samples.RotationKeys.size() - 1)
+			{
+				poseRotation = startKey.Value;
+			}
+			else
+			{
+				const Animix::RotationKey& endKey = samples.RotationKeys[keyIndex + 1];
+				const float t = (time - startKey.StartTime) / (endKey.StartTime - startKey.StartTime);
+				poseRotation.Slerp(startKey.Value, endKey.Value, t);
+			}
+		}
+
+		outPose.LocalPose[joint].P = posePosition;
+		outPose.LocalPose[joint].Q = poseRotation;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include "Animix/AnimationClip.h"
+
+
+/**
+ * A copy of the clip layout AnimationClip replaced, kept to measure the packed layout against.
+ * Each joint holds its keys in two vectors of its own, with each key's time next to its value
+ */
+class JointSamplesClip
+{
+public:
+	struct JointSamples
+	{
+		std::vector<Animix::PositionKey> PositionKeys;
+		std::vector<Animix::RotationKey> RotationKeys;
+	};
+
+	explicit JointSamplesClip(size_t jointCount) : m_JointSamples(jointCount) {}
+
+	// Samples every joint, as AnimationClip::BuildLocalPose did before the keys were packed
+	void BuildLocalPose(float time, Animix::SkeletonPose& outPose, Animix::KeyCursorCache* cursors = nullptr) const;
+
+	inline void SetJointSamples(size_t jointIndex, JointSamples&& samples) { m_JointSamples[jointIndex] = std::move(samples); }
+
+private:
+	std::vector<JointSamples> m_JointSamples;
+};
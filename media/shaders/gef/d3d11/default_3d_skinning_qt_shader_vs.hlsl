@@ -0,0 +1,94 @@
+#define NUM_LIGHTS 4
+#define NUM_BONES 128
+
+cbuffer MatrixBuffer
+{
+	matrix wvp;
+	matrix world;
+	float4 light_position[NUM_LIGHTS];
+	// Two per bone: the rotation quaternion, then the translation in xyz
+	float4 bone_transforms[NUM_BONES * 2];
+};
+
+struct VertexInput
+{
+    float4 position : POSITION;
+    float3 normal : NORMAL;
+	int blendindices : BLENDINDICES;
+	float4 blendweights : BLENDWEIGHT;
+    float2 uv : TEXCOORD;
+};
+
+struct PixelInput
+{
+    float4 position : SV_POSITION;
+    float3 normal: NORMAL;
+    float2 uv : TEXCOORD0;
+    float3 light_vector1 : TEXCOORD1;
+    float3 light_vector2 : TEXCOORD2;
+    float3 light_vector3 : TEXCOORD3;
+    float3 light_vector4 : TEXCOORD4;
+};
+
+float3 rotate(float4 q, float3 v)
+{
+	float3 t = 2.0 * cross(q.xyz, v);
+	return v + q.w * t + cross(q.xyz, t);
+}
+
+float3 transform_position(uint bone, float3 position)
+{
+	return rotate(bone_transforms[bone * 2], position) + bone_transforms[bone * 2 + 1].xyz;
+}
+
+float3 transform_normal(uint bone, float3 normal)
+{
+	return rotate(bone_transforms[bone * 2], normal);
+}
+
+void VS( in VertexInput input,
+         out PixelInput output )
+{
+    output.uv = input.uv;
+	
+	uint4 indices = uint4(
+	(input.blendindices & 0x000000ff),
+	(input.blendindices & 0x0000ff00) >> 8,
+	(input.blendindices & 0x00ff0000) >> 16,
+	(input.blendindices & 0xff000000) >> 24
+	);
+
+    float4 normal = float4(input.normal, 0);
+	input.position.w = 1.0;
+	
+	// bone 0
+	float4 world_position = float4(input.blendweights.x*transform_position(indices.x, input.position.xyz), 1.0);
+	float4 world_normal = float4(input.blendweights.x*transform_normal(indices.x, normal.xyz), 0.0);
+
+	// bone 1
+	world_position.xyz += input.blendweights.y*transform_position(indices.y, input.position.xyz);
+	world_normal.xyz += input.blendweights.y*transform_normal(indices.y, normal.xyz);
+	
+	// bone 2
+	world_position.xyz += input.blendweights.z*transform_position(indices.z, input.position.xyz);
+	world_normal.xyz += input.blendweights.z*transform_normal(indices.z, normal.xyz);
+
+	// bone 3
+	world_position.xyz += input.blendweights.w*transform_position(indices.w, input.position.xyz);
+	world_normal.xyz += input.blendweights.w*transform_normal(indices.w, normal.xyz);
+
+    normal = mul(world_normal, world);
+    output.normal = normalize(normal.xyz);
+	
+    output.position = mul(world_position, wvp);	
+    world_position = mul(world_position, world);
+	
+    output.light_vector1 = light_position[0].xyz - world_position.xyz;
+    output.light_vector1 = normalize(output.light_vector1);
+    output.light_vector2 = light_position[1].xyz - world_position.xyz;
+    output.light_vector2 = normalize(output.light_vector2);
+    output.light_vector3 = light_position[2].xyz - world_position.xyz;
+    output.light_vector3 = normalize(output.light_vector3);
+    output.light_vector4 = light_position[3].xyz - world_position.xyz;
+    output.light_vector4 = normalize(output.light_vector4);
+}
@@ -13,11 +13,15 @@
 #include <platform/d3d11/system/platform_d3d11.h>
 #include <platform/d3d11/input/keyboard_d3d11.h>
 
+#include <algorithm>
 #include <cassert>
+#include <thread>
 
 #include "Animix/AniPhysix/Utility.h"
 #include "BulletDynamics/Dynamics/btRigidBody.h"
 
+using Animix::operator""_id;
+
 
 SceneApp::SceneApp(gef::Platform& platform) :
 	Application(platform),
@@ -94,17 +98,17 @@ void SceneApp::Init()
 	m_Player->set_mesh(m_Mesh.get());
 
 	// Create an animator
-	m_PlayerAnimator = m_AnimationEngine->CreateAnimator(skeletons.front());
+	m_PlayerAnimator = m_AnimationEngine->GetAnimator(m_AnimationEngine->CreateAnimator(skeletons.front()));
 	m_PlayerAnimator->CreateRagdoll(m_PhysicsWorld->GetWorld(), "xbot\\ragdoll.bullet");
 	assert(m_PlayerAnimator->LoadFromJSON("xbot\\xbot_basic_state_machine.json"));
 
 	// Load default values of parameters
-	if (m_PlayerAnimator->GetParameterTable()->ParameterExists("walkSpeed"))
-		m_WalkSpeed = m_PlayerAnimator->GetParameterTable()->GetParameter("walkSpeed");
-	if (m_PlayerAnimator->GetParameterTable()->ParameterExists("walkDir"))
-		m_WalkDir = m_PlayerAnimator->GetParameterTable()->GetParameter("walkDir");
-	if (m_PlayerAnimator->GetParameterTable()->ParameterExists("injured"))
-		m_Injured = m_PlayerAnimator->GetParameterTable()->GetParameter("injured");
+	if (m_PlayerAnimator->GetParameterTable()->ParameterExists("walkSpeed"_id))
+		m_WalkSpeed = m_PlayerAnimator->GetParameterTable()->GetParameter("walkSpeed"_id);
+	if (m_PlayerAnimator->GetParameterTable()->ParameterExists("walkDir"_id))
+		m_WalkDir = m_PlayerAnimator->GetParameterTable()->GetParameter("walkDir"_id);
+	if (m_PlayerAnimator->GetParameterTable()->ParameterExists("injured"_id))
+		m_Injured = m_PlayerAnimator->GetParameterTable()->GetParameter("injured"_id);
 
 	// Create ground
 	const btRigidBody* groundRB = m_PhysicsWorld->CreateGround();
@@ -274,7 +278,7 @@ void SceneApp::Render3D()
 
 	// draw the player, the pose is defined by the bone matrices
 	if (m_Player)
-		m_Renderer3D->DrawSkinnedMesh(*m_Player, m_PlayerAnimator->GetMatrixPalette());
+		m_Renderer3D->DrawSkinnedMesh(*m_Player, m_PlayerAnimator->AcquireMatrixPalette());
 
 	m_Renderer3D->DrawMesh(m_Floor);
 	if (m_ShowPhysics)
@@ -304,35 +308,35 @@ void SceneApp::DrawImGui3D()
 {
 	ImGui::Text("Parameters");
 
-	if (m_PlayerAnimator->GetParameterTable()->ParameterExists("walkSpeed")
+	if (m_PlayerAnimator->GetParameterTable()->ParameterExists("walkSpeed"_id)
 		&& ImGui::SliderFloat("Walk Speed", &m_WalkSpeed, 0.0f, 1.0f))
 	{
-		m_PlayerAnimator->GetParameterTable()->SetParam("walkSpeed", m_WalkSpeed);
+		m_PlayerAnimator->GetParameterTable()->SetParam("walkSpeed"_id, m_WalkSpeed);
 	}
-	if (m_PlayerAnimator->GetParameterTable()->ParameterExists("walkDir")
+	if (m_PlayerAnimator->GetParameterTable()->ParameterExists("walkDir"_id)
 		&& ImGui::SliderFloat("Walk Direction", &m_WalkDir, -1.0f, 1.0f))
 	{
-		m_PlayerAnimator->GetParameterTable()->SetParam("walkDir", m_WalkDir);
+		m_PlayerAnimator->GetParameterTable()->SetParam("walkDir"_id, m_WalkDir);
 	}
-	if (m_PlayerAnimator->GetParameterTable()->ParameterExists("injured")
+	if (m_PlayerAnimator->GetParameterTable()->ParameterExists("injured"_id)
 		&& ImGui::SliderFloat("Injured", &m_Injured, 0.0f, 1.0f))
 	{
-		m_PlayerAnimator->GetParameterTable()->SetParam("injured", m_Injured);
+		m_PlayerAnimator->GetParameterTable()->SetParam("injured"_id, m_Injured);
 	}
 
 	ImGui::Separator();
 	ImGui::Text("Actions");
 
 	if (ImGui::Button("Idle"))
-		m_PlayerAnimator->Transition("idle");
+		m_PlayerAnimator->Transition("idle"_id);
 	if (ImGui::Button("Walk"))
-		m_PlayerAnimator->Transition("walk");
+		m_PlayerAnimator->Transition("walk"_id);
 	if (ImGui::Button("Jump"))
-		m_PlayerAnimator->Transition("jump");
+		m_PlayerAnimator->Transition("jump"_id);
 	if (ImGui::Button("Die"))
-		m_PlayerAnimator->Transition("death");
+		m_PlayerAnimator->Transition("death"_id);
 	if (ImGui::Button("Respawn"))
-		m_PlayerAnimator->Transition("respawn");
+		m_PlayerAnimator->Transition("respawn"_id);
 
 	ImGui::Separator();
 	ImGui::Text("Animators");
@@ -347,18 +351,89 @@ void SceneApp::DrawImGui3D()
 
 	if (reloadVars)
 	{
-		if (m_PlayerAnimator->GetParameterTable()->ParameterExists("walkSpeed"))
-			m_PlayerAnimator->GetParameterTable()->SetParam("walkSpeed", m_WalkSpeed);
-		if (m_PlayerAnimator->GetParameterTable()->ParameterExists("walkDir"))
-			m_PlayerAnimator->GetParameterTable()->SetParam("walkDir", m_WalkDir);
-		if (m_PlayerAnimator->GetParameterTable()->ParameterExists("injured"))
-			m_PlayerAnimator->GetParameterTable()->SetParam("injured", m_Injured);
+		if (m_PlayerAnimator->GetParameterTable()->ParameterExists("walkSpeed"_id))
+			m_PlayerAnimator->GetParameterTable()->SetParam("walkSpeed"_id, m_WalkSpeed);
+		if (m_PlayerAnimator->GetParameterTable()->ParameterExists("walkDir"_id))
+			m_PlayerAnimator->GetParameterTable()->SetParam("walkDir"_id, m_WalkDir);
+		if (m_PlayerAnimator->GetParameterTable()->ParameterExists("injured"_id))
+			m_PlayerAnimator->GetParameterTable()->SetParam("injured"_id, m_Injured);
 	}
 
 	ImGui::Separator();
 	ImGui::Text("Debug");
 
 	ImGui::Checkbox("Show Physics", &m_ShowPhysics);
+
+	bool accurateBlending = m_AnimationEngine->GetRotationBlendMode() == Animix::RotationBlendMode::Slerp;
+	if (ImGui::Checkbox("Accurate Rotation Blending", &accurateBlending))
+		m_AnimationEngine->SetRotationBlendMode(accurateBlending ? Animix::RotationBlendMode::Slerp : Animix::RotationBlendMode::NLerp);
+
+	bool poseBatching = m_AnimationEngine->GetPoseBatching();
+	if (ImGui::Checkbox("Batch Global Poses", &poseBatching))
+		m_AnimationEngine->SetPoseBatching(poseBatching);
+
+	bool compiledBlendTrees = m_AnimationEngine->GetCompiledBlendTrees();
+	if (ImGui::Checkbox("Compiled Blend Trees", &compiledBlendTrees))
+		m_AnimationEngine->SetCompiledBlendTrees(compiledBlendTrees);
+
+	// Leave a core for the main thread
+	const int maxWorkers = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 0);
+	int workerCount = static_cast<int>(m_AnimationEngine->GetWorkerCount());
+	if (ImGui::SliderInt("Animation Workers", &workerCount, 0, maxWorkers))
+		m_AnimationEngine->SetWorkerCount(static_cast<uint32_t>(workerCount));
+
+	ImGui::Text("Unchanged Animators: %zu / %zu", m_AnimationEngine->GetSkippedAnimatorCount(), m_AnimationEngine->GetAnimatorCount());
+	for (size_t i = 0; i < m_AnimationEngine->GetFrameArenaCount(); i++)
+	{
+		const Animix::FrameArena& arena = m_AnimationEngine->GetFrameArena(i);
+		ImGui::Text("Frame Arena %zu: %zu poses, %zu / %zu bytes", i, arena.GetPoseHighWaterMark(), arena.GetHighWaterMark(), arena.GetCapacity());
+	}
+
+	DrawAnimationProfiler();
+}
+
+void SceneApp::DrawAnimationProfiler()
+{
+	if (!ImGui::CollapsingHeader("Animation Profiler"))
+		return;
+
+	Animix::Profiler& profiler = m_AnimationEngine->GetProfiler();
+
+	bool enabled = profiler.IsEnabled();
+	if (ImGui::Checkbox("Enable Profiling", &enabled))
+		profiler.SetEnabled(enabled);
+	if (!enabled)
+		return;
+
+	if (!profiler.IsCapturingTrace())
+	{
+		if (ImGui::Button("Start Trace Capture"))
+			profiler.BeginTraceCapture();
+	}
+	else if (ImGui::Button("Save Trace Capture"))
+	{
+		profiler.EndTraceCapture("animix_trace.json");
+	}
+
+	const Animix::ProfileReport& report = profiler.GetReport();
+	ImGui::Text("Animation Tick: %.3f ms", report.FrameMs);
+
+	ImGui::Columns(5, "ProfileReport");
+	ImGui::Text("Scope"); ImGui::NextColumn();
+	ImGui::Text("Detail"); ImGui::NextColumn();
+	ImGui::Text("Calls"); ImGui::NextColumn();
+	ImGui::Text("Self ms"); ImGui::NextColumn();
+	ImGui::Text("Total ms"); ImGui::NextColumn();
+	ImGui::Separator();
+	for (const Animix::ProfileReportEntry& entry : report.Entries)
+	{
+		ImGui::Text("%s", entry.Name); ImGui::NextColumn();
+		ImGui::Text("%s", Animix::GetInternedName(entry.Detail).c_str()); ImGui::NextColumn();
+		ImGui::Text("%u", entry.Calls); ImGui::NextColumn();
+		ImGui::Text("%.3f", entry.SelfMs); ImGui::NextColumn();
+		ImGui::Text("%.3f", entry.TotalMs); ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
 }
 
 
@@ -56,6 +56,7 @@ public:
 
 	void DrawImGui2D();
 	void DrawImGui3D();
+	void DrawAnimationProfiler();
 
 private:
 	void SetupLights() const;